@@ -0,0 +1,152 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+// Common helpers of TinyODBC benchmarks: timing and JSON report
+
+#ifndef _TIODBC_BENCH_COMMON_HPP_DEFINED_
+#define _TIODBC_BENCH_COMMON_HPP_DEFINED_
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tiodbc_bench
+{
+	//! Get monotonic time in seconds
+	inline double now()
+	{
+	#ifdef _WIN32
+		LARGE_INTEGER freq, count;
+		QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&count);
+		return (double)count.QuadPart / (double)freq.QuadPart;
+	#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+	#endif
+	}
+
+	//! Measurements of one benchmark case
+	struct result
+	{
+		std::string name;				//!< What is measured, e.g. "fetch"
+		std::string mode;				//!< Variant of the case, e.g. "rowset"
+		long rows;						//!< Rows of the table
+		long width;						//!< Width of the text column
+		long ops;						//!< Operations (rows, executions, connects) per run
+		std::vector<double> seconds;	//!< Duration of every run
+		std::vector<std::pair<std::string, double> > extra;	//!< Additional metrics, e.g. calls per operation
+
+		result(const std::string & _name, const std::string & _mode, long _rows, long _width, long _ops)
+			:name(_name), mode(_mode), rows(_rows), width(_width), ops(_ops)
+		{}
+
+		//! Fastest run
+		double best() const
+		{
+			return seconds.empty()?0:*std::min_element(seconds.begin(), seconds.end());
+		}
+
+		//! Median run
+		double median() const
+		{
+			if (seconds.empty())
+				return 0;
+			std::vector<double> sorted(seconds);
+			std::sort(sorted.begin(), sorted.end());
+			size_t n = sorted.size();
+			return (n % 2)?sorted[n / 2]:(sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+		}
+	};
+
+	//! Escape a string for JSON
+	inline std::string json_string(const std::string & _str)
+	{
+		std::string out = "\"";
+		for(size_t i = 0;i < _str.size();i++)
+		{
+			char c = _str[i];
+			if ((c == '"') || (c == '\\'))
+			{
+				out += '\\';
+				out += c;
+			}
+			else if ((unsigned char)c < 0x20)
+				out += ' ';
+			else
+				out += c;
+		}
+		return out + "\"";
+	}
+
+	//! Write the results of a suite as JSON
+	/**
+		Every result becomes an object with its shape, the best and median duration
+		of its runs, operations per second and nanoseconds per operation of the median run,
+		followed by its extra metrics.
+	*/
+	inline void write_json(std::ostream & _out,
+		const std::string & _suite,
+		const std::vector<std::pair<std::string, std::string> > & _context,
+		const std::vector<result> & _results)
+	{
+		_out.precision(9);
+		_out << "{\n  \"suite\": " << json_string(_suite) << ",\n  \"context\": {";
+		for(size_t i = 0;i < _context.size();i++)
+			_out << (i?", ":"") << json_string(_context[i].first) << ": " << json_string(_context[i].second);
+		_out << "},\n  \"results\": [";
+		for(size_t i = 0;i < _results.size();i++)
+		{
+			const result & r = _results[i];
+			double median = r.median();
+			_out << (i?",":"") << "\n    {\"name\": " << json_string(r.name)
+				<< ", \"mode\": " << json_string(r.mode)
+				<< ", \"rows\": " << r.rows
+				<< ", \"width\": " << r.width
+				<< ", \"ops\": " << r.ops
+				<< ", \"runs\": " << r.seconds.size()
+				<< ", \"seconds_best\": " << r.best()
+				<< ", \"seconds_median\": " << median
+				<< ", \"ops_per_sec\": " << ((median > 0)?r.ops / median:0)
+				<< ", \"ns_per_op\": " << ((r.ops > 0)?median * 1e9 / r.ops:0);
+			for(size_t j = 0;j < r.extra.size();j++)
+				_out << ", " << json_string(r.extra[j].first) << ": " << r.extra[j].second;
+			_out << "}";
+		}
+		_out << "\n  ]\n}\n";
+	}
+}
+
+#endif // !_TIODBC_BENCH_COMMON_HPP_DEFINED_
@@ -0,0 +1,1196 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+/*
+	In-process stub of the ODBC API.
+
+	Every statement whose text starts with SELECT produces the synthetic
+	result set described by mock_odbc_config, any other statement consumes
+	its parameters and succeeds. Column letters of mock_odbc_config::columns:
+	  - i INTEGER			- b BIGINT
+	  - d DOUBLE			- n DECIMAL(18,2)
+	  - s VARCHAR(width)	- c CHAR(width)
+	  - x VARBINARY(width)	- l LONGVARCHAR (lob_size long)
+	  - t TIMESTAMP			- g GUID
+	.
+	Values are computed from (row, column) on demand so that serving them
+	allocates nothing. Only the narrow character API and column-wise binding
+	are implemented. It needs C++11 (std::atomic) and clock_gettime().
+*/
+
+#include "./mock_odbc.h"
+#include <sqlext.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+#include <map>
+#include <atomic>
+
+namespace
+{
+	///////////////////////////////////////////////////////////////////////////////////
+	// STATE
+	///////////////////////////////////////////////////////////////////////////////////
+
+	mock_odbc_config g_config = { 1000, "ibds", 32, 4096, 0, 0, 0, 0 };
+	std::atomic<unsigned long> g_calls(0);
+	std::atomic<unsigned long> g_rows_written(0);
+	std::atomic<unsigned long long> g_bytes_put(0);
+	std::atomic<long long> g_param_sum(0);
+	std::atomic<unsigned long> g_commits(0);
+
+	enum handle_kind { hk_env = 1, hk_dbc, hk_stmt, hk_desc };
+	enum async_op { op_none = 0, op_execute, op_exec_direct, op_fetch };
+
+	struct mock_handle
+	{
+		int kind;
+		char state[6];
+		char message[128];
+
+		explicit mock_handle(int _kind)
+			:kind(_kind)
+		{	state[0] = 0;	message[0] = 0;	}
+	};
+
+	struct mock_dbc : mock_handle
+	{
+		bool connected;
+		SQLULEN autocommit;
+		mock_dbc() :mock_handle(hk_dbc), connected(false), autocommit(SQL_AUTOCOMMIT_ON) {}
+	};
+
+	// One bound column or parameter (ARD / APD record)
+	struct mock_record
+	{
+		SQLSMALLINT ctype;
+		SQLSMALLINT sqltype;
+		SQLSMALLINT precision;
+		SQLSMALLINT scale;
+		SQLPOINTER ptr;
+		SQLLEN width;
+		SQLLEN * ind;
+		mock_record() :ctype(0), sqltype(0), precision(38), scale(0), ptr(NULL), width(0), ind(NULL) {}
+	};
+
+	struct mock_stmt;
+	struct mock_desc : mock_handle
+	{
+		mock_stmt * stmt;
+		std::map<int, mock_record> * recs;
+		mock_desc() :mock_handle(hk_desc), stmt(NULL), recs(NULL) {}
+	};
+
+	struct mock_stmt : mock_handle
+	{
+		mock_dbc * dbc;
+		bool prepared;
+		bool select;
+		bool has_result;
+		char columns[64];
+		long rows;
+		long next_row;
+		long cur_row;
+		long cur_count;
+		long pos;
+		SQLULEN row_array_size;
+		SQLULEN * rows_fetched;
+		SQLUSMALLINT * row_status;
+		SQLULEN * bind_offset;
+		SQLULEN paramset_size;
+		SQLUSMALLINT * param_status;
+		SQLULEN * params_processed;
+		SQLULEN async;
+		int async_op;
+		long async_left;
+		int gd_col;
+		SQLLEN gd_offset;
+		bool gd_done;
+		int dae_param;
+		SQLLEN row_count;
+		std::map<int, mock_record> bindings;
+		std::map<int, mock_record> params;
+		mock_desc ard;
+		mock_desc apd;
+
+		mock_stmt()
+			:mock_handle(hk_stmt), dbc(NULL), prepared(false), select(false), has_result(false),
+			rows(0), next_row(0), cur_row(0), cur_count(0), pos(0),
+			row_array_size(1), rows_fetched(NULL), row_status(NULL), bind_offset(NULL),
+			paramset_size(1), param_status(NULL), params_processed(NULL),
+			async(SQL_ASYNC_ENABLE_OFF), async_op(op_none), async_left(0),
+			gd_col(0), gd_offset(0), gd_done(false), dae_param(0), row_count(0)
+		{
+			columns[0] = 0;
+			ard.stmt = this;	ard.recs = &bindings;
+			apd.stmt = this;	apd.recs = &params;
+		}
+	};
+
+	// Count a call and spend the injected latency
+	void __mock_call()
+	{
+		g_calls++;
+		if (g_config.latency_ns <= 0)
+			return;
+		if (g_config.latency_sleeps)
+		{
+			timespec wait = { g_config.latency_ns / 1000000000L, g_config.latency_ns % 1000000000L };
+			nanosleep(&wait, NULL);
+			return;
+		}
+
+		timespec start, now;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		} while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < g_config.latency_ns);
+	}
+
+	SQLRETURN __fail(mock_handle * _h, const char * _state, const char * _message)
+	{
+		strncpy(_h->state, _state, sizeof(_h->state) - 1);
+		_h->state[sizeof(_h->state) - 1] = 0;
+		strncpy(_h->message, _message, sizeof(_h->message) - 1);
+		_h->message[sizeof(_h->message) - 1] = 0;
+		return SQL_ERROR;
+	}
+
+	SQLRETURN __ok(mock_handle * _h, SQLRETURN _rc = SQL_SUCCESS)
+	{
+		_h->state[0] = 0;
+		_h->message[0] = 0;
+		return _rc;
+	}
+
+	// Simulate an asynchronous call, returns true while it is still executing
+	bool __async_pending(mock_stmt * _s, int _op)
+	{
+		if (_s->async != SQL_ASYNC_ENABLE_ON)
+			return false;
+
+		if (_s->async_op != _op)
+		{	// A new asynchronous operation
+			_s->async_op = _op;
+			_s->async_left = g_config.async_polls;
+		}
+		if (_s->async_left > 0)
+		{
+			_s->async_left--;
+			return true;
+		}
+		_s->async_op = op_none;
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// SYNTHETIC VALUES
+	///////////////////////////////////////////////////////////////////////////////////
+
+	int __column_count(const mock_stmt * _s)
+	{
+		return (int)strlen(_s->columns);
+	}
+
+	SQLSMALLINT __column_sqltype(char _c)
+	{
+		switch(_c)
+		{
+		case 'i': return SQL_INTEGER;
+		case 'b': return SQL_BIGINT;
+		case 'd': return SQL_DOUBLE;
+		case 'n': return SQL_DECIMAL;
+		case 's': return SQL_VARCHAR;
+		case 'c': return SQL_CHAR;
+		case 'x': return SQL_VARBINARY;
+		case 'l': return SQL_LONGVARCHAR;
+		case 't': return SQL_TYPE_TIMESTAMP;
+		case 'g': return SQL_GUID;
+		}
+		return SQL_UNKNOWN_TYPE;
+	}
+
+	SQLULEN __column_size(char _c)
+	{
+		switch(_c)
+		{
+		case 'i': return 10;
+		case 'b': return 19;
+		case 'd': return 15;
+		case 'n': return 18;
+		case 's':
+		case 'c':
+		case 'x': return (SQLULEN)g_config.string_width;
+		case 'l': return 2147483647;
+		case 't': return 23;
+		case 'g': return 36;
+		}
+		return 0;
+	}
+
+	SQLSMALLINT __column_digits(char _c)
+	{
+		if (_c == 'n') return 2;
+		if (_c == 't') return 3;
+		return 0;
+	}
+
+	bool __is_null(long _row)
+	{
+		return (g_config.null_every > 0) && ((_row % g_config.null_every) == g_config.null_every - 1);
+	}
+
+	long long __int_value(char _c, long _row, int _col, int _ncols)
+	{
+		if (_c == 'b')
+			return (long long)_row * 1000003LL + _col;
+		if (_c == 'n')	// Unscaled, scale 2
+			return (long long)_row * 100 + _col;
+		return (long long)_row * _ncols + _col;
+	}
+
+	double __double_value(char _c, long _row, int _col, int _ncols)
+	{
+		if (_c == 'd')
+			return _row + _col * 0.25;
+		if (_c == 'n')
+			return __int_value(_c, _row, _col, _ncols) / 100.0;
+		return (double)__int_value(_c, _row, _col, _ncols);
+	}
+
+	// Length in bytes of character/binary values
+	SQLLEN __bytes_length(char _c, long _row)
+	{
+		if (_c == 's')
+			return 1 + (_row % g_config.string_width);
+		if (_c == 'l')
+			return g_config.lob_size;
+		return g_config.string_width;
+	}
+
+	char __byte_at(char _c, long _row, int _col, SQLLEN _i)
+	{
+		if (_c == 'x')
+			return (char)((_row + _col + _i) & 0xff);
+		return (char)('a' + (_row + _col + _i) % 26);
+	}
+
+	void __timestamp_value(long _row, int _col, SQL_TIMESTAMP_STRUCT & _ts)
+	{
+		_ts.year = 2020;
+		_ts.month = 1;
+		_ts.day = (SQLUSMALLINT)(1 + (_row / 86400) % 28);
+		_ts.hour = (SQLUSMALLINT)((_row / 3600) % 24);
+		_ts.minute = (SQLUSMALLINT)((_row / 60) % 60);
+		_ts.second = (SQLUSMALLINT)(_row % 60);
+		_ts.fraction = (SQLUINTEGER)(_col * 1000000);
+	}
+
+	// Render a non character value as text, returns its length
+	int __format_value(char _c, long _row, int _col, int _ncols, char * _buf, size_t _size)
+	{
+		switch(_c)
+		{
+		case 'i':
+		case 'b':
+			return snprintf(_buf, _size, "%lld", __int_value(_c, _row, _col, _ncols));
+		case 'd':
+			return snprintf(_buf, _size, "%.17g", __double_value(_c, _row, _col, _ncols));
+		case 'n':
+		{
+			long long v = __int_value(_c, _row, _col, _ncols);
+			return snprintf(_buf, _size, "%lld.%02lld", v / 100, v % 100);
+		}
+		case 't':
+		{
+			SQL_TIMESTAMP_STRUCT ts;
+			__timestamp_value(_row, _col, ts);
+			return snprintf(_buf, _size, "%04d-%02u-%02u %02u:%02u:%02u.%03u",
+				ts.year, ts.month, ts.day, ts.hour, ts.minute, ts.second, ts.fraction / 1000000);
+		}
+		case 'g':
+			return snprintf(_buf, _size, "%08lX-%04X-0000-0000-000000000000", (unsigned long)_row, (unsigned)_col);
+		}
+		return 0;
+	}
+
+	bool __is_bytes(char _c)
+	{
+		return _c == 's' || _c == 'c' || _c == 'x' || _c == 'l';
+	}
+
+	void __fill_numeric(long long _unscaled, int _from_scale, const mock_record * _rec, SQL_NUMERIC_STRUCT * _num)
+	{
+		int to_scale = _rec ? _rec->scale : 0;
+		unsigned long long mag = (unsigned long long)(_unscaled < 0 ? -_unscaled : _unscaled);
+		for(; to_scale > _from_scale; _from_scale++)
+			mag *= 10;
+		for(; to_scale < _from_scale; _from_scale--)
+			mag /= 10;
+
+		memset(_num, 0, sizeof(*_num));
+		_num->precision = (SQLCHAR)(_rec ? _rec->precision : 38);
+		_num->scale = (SQLSCHAR)to_scale;
+		_num->sign = (_unscaled < 0) ? 0 : 1;
+		for(int i = 0; i < 8; i++)
+			_num->val[i] = (SQLCHAR)((mag >> (8 * i)) & 0xff);
+	}
+
+	// Convert value (_row, _col) into a C buffer. _offset is used for piecewise
+	// SQLGetData of character/binary data and is NULL for bound columns.
+	SQLRETURN __convert(mock_stmt * _s, long _row, int _col, SQLSMALLINT _ctype, const mock_record * _rec,
+		SQLPOINTER _target, SQLLEN _buflen, SQLLEN * _ind, SQLLEN * _offset)
+	{
+		const int ncols = __column_count(_s);
+		const char c = _s->columns[_col - 1];
+
+		if (__is_null(_row))
+		{
+			if (!_ind)
+				return __fail(_s, "22002", "Indicator variable required but not supplied");
+			*_ind = SQL_NULL_DATA;
+			return SQL_SUCCESS;
+		}
+
+		if ((_ctype == SQL_ARD_TYPE) && _rec)
+			_ctype = _rec->ctype;
+		if (_ctype == SQL_C_DEFAULT)
+			_ctype = SQL_C_CHAR;
+
+		switch(_ctype)
+		{
+		case SQL_C_CHAR:
+		case SQL_C_BINARY:
+		{
+			char tmp[64];
+			const bool text = (_ctype == SQL_C_CHAR);
+			SQLLEN total;
+			if (__is_bytes(c))
+				total = __bytes_length(c, _row) * ((c == 'x' && text) ? 2 : 1);
+			else if (!text)
+				return __fail(_s, "07006", "Restricted data type attribute violation");
+			else
+				total = __format_value(c, _row, _col, ncols, tmp, sizeof(tmp));
+
+			const SQLLEN start = _offset ? *_offset : 0;
+			const SQLLEN remaining = total - start;
+			const SQLLEN room = text ? (_buflen > 0 ? _buflen - 1 : 0) : _buflen;
+			const SQLLEN n = (remaining < room) ? remaining : room;
+			char * dst = (char *)_target;
+			for(SQLLEN i = 0; i < n; i++)
+			{
+				const SQLLEN at = start + i;
+				if (!__is_bytes(c))
+					dst[i] = tmp[at];
+				else if (c == 'x' && text)
+				{
+					static const char hex[] = "0123456789ABCDEF";
+					unsigned char b = (unsigned char)__byte_at(c, _row, _col, at / 2);
+					dst[i] = hex[(at % 2) ? (b & 0xf) : (b >> 4)];
+				}
+				else
+					dst[i] = __byte_at(c, _row, _col, at);
+			}
+			if (text && _buflen > 0)
+				dst[n] = 0;
+			if (_ind)
+				*_ind = remaining;
+			if (_offset)
+				*_offset = start + n;
+			if (n < remaining)
+			{
+				strcpy(_s->state, "01004");
+				strcpy(_s->message, "String data, right truncated");
+				return SQL_SUCCESS_WITH_INFO;
+			}
+			return SQL_SUCCESS;
+		}
+		case SQL_C_SLONG:
+		case SQL_C_LONG:
+		case SQL_C_ULONG:
+		case SQL_C_SSHORT:
+		case SQL_C_SHORT:
+		case SQL_C_USHORT:
+		case SQL_C_SBIGINT:
+		case SQL_C_UBIGINT:
+		case SQL_C_STINYINT:
+		case SQL_C_UTINYINT:
+		case SQL_C_TINYINT:
+		case SQL_C_BIT:
+		{
+			long long v;
+			if (c == 'n')
+				v = __int_value(c, _row, _col, ncols) / 100;
+			else if (c == 'd')
+				v = (long long)__double_value(c, _row, _col, ncols);
+			else if (c == 'i' || c == 'b')
+				v = __int_value(c, _row, _col, ncols);
+			else
+				return __fail(_s, "22018", "Invalid character value for cast specification");
+
+			SQLLEN size;
+			switch(_ctype)
+			{
+			case SQL_C_SBIGINT:
+			case SQL_C_UBIGINT:	*(long long *)_target = v;	size = 8;	break;
+			case SQL_C_SSHORT:
+			case SQL_C_SHORT:
+			case SQL_C_USHORT:	*(short *)_target = (short)v;	size = 2;	break;
+			case SQL_C_STINYINT:
+			case SQL_C_UTINYINT:
+			case SQL_C_TINYINT:
+			case SQL_C_BIT:		*(char *)_target = (char)v;	size = 1;	break;
+			default:			*(SQLINTEGER *)_target = (SQLINTEGER)v;	size = 4;	break;
+			}
+			if (_ind)
+				*_ind = size;
+			return SQL_SUCCESS;
+		}
+		case SQL_C_DOUBLE:
+		case SQL_C_FLOAT:
+		{
+			if (!(c == 'i' || c == 'b' || c == 'd' || c == 'n'))
+				return __fail(_s, "22018", "Invalid character value for cast specification");
+			double v = __double_value(c, _row, _col, ncols);
+			if (_ctype == SQL_C_DOUBLE)
+				*(double *)_target = v;
+			else
+				*(float *)_target = (float)v;
+			if (_ind)
+				*_ind = (_ctype == SQL_C_DOUBLE) ? 8 : 4;
+			return SQL_SUCCESS;
+		}
+		case SQL_C_NUMERIC:
+		{
+			if (!(c == 'i' || c == 'b' || c == 'n'))
+				return __fail(_s, "22018", "Invalid character value for cast specification");
+			__fill_numeric(__int_value(c, _row, _col, ncols), (c == 'n') ? 2 : 0, _rec, (SQL_NUMERIC_STRUCT *)_target);
+			if (_ind)
+				*_ind = sizeof(SQL_NUMERIC_STRUCT);
+			return SQL_SUCCESS;
+		}
+		case SQL_C_TYPE_TIMESTAMP:
+		case SQL_C_TIMESTAMP:
+		{
+			if (c != 't')
+				return __fail(_s, "07006", "Restricted data type attribute violation");
+			__timestamp_value(_row, _col, *(SQL_TIMESTAMP_STRUCT *)_target);
+			if (_ind)
+				*_ind = sizeof(SQL_TIMESTAMP_STRUCT);
+			return SQL_SUCCESS;
+		}
+		case SQL_C_GUID:
+		{
+			if (c != 'g')
+				return __fail(_s, "07006", "Restricted data type attribute violation");
+			SQLGUID * g = (SQLGUID *)_target;
+			memset(g, 0, sizeof(*g));
+			g->Data1 = (DWORD)_row;
+			g->Data2 = (WORD)_col;
+			if (_ind)
+				*_ind = sizeof(SQLGUID);
+			return SQL_SUCCESS;
+		}
+		}
+		return __fail(_s, "HY003", "Invalid application buffer type");
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// EXECUTION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	bool __is_select(const SQLCHAR * _sql, SQLINTEGER _len)
+	{
+		const char * p = (const char *)_sql;
+		size_t len = (_len == SQL_NTS) ? strlen(p) : (size_t)_len;
+		size_t i = 0;
+		while(i < len && isspace((unsigned char)p[i]))
+			i++;
+		return (len - i >= 6) && (strncasecmp(p + i, "select", 6) == 0);
+	}
+
+	bool __is_data_at_exec(const SQLLEN * _ind)
+	{
+		return _ind && ((*_ind == SQL_DATA_AT_EXEC) || (*_ind <= SQL_LEN_DATA_AT_EXEC_OFFSET));
+	}
+
+	SQLLEN __c_type_size(SQLSMALLINT _ctype)
+	{
+		switch(_ctype)
+		{
+		case SQL_C_SBIGINT:
+		case SQL_C_UBIGINT:
+		case SQL_C_DOUBLE:	return 8;
+		case SQL_C_SSHORT:
+		case SQL_C_USHORT:
+		case SQL_C_SHORT:	return 2;
+		case SQL_C_STINYINT:
+		case SQL_C_UTINYINT:
+		case SQL_C_TINYINT:
+		case SQL_C_BIT:		return 1;
+		case SQL_C_TYPE_TIMESTAMP:
+		case SQL_C_TIMESTAMP:	return sizeof(SQL_TIMESTAMP_STRUCT);
+		case SQL_C_NUMERIC:	return sizeof(SQL_NUMERIC_STRUCT);
+		case SQL_C_GUID:	return sizeof(SQLGUID);
+		}
+		return 4;
+	}
+
+	// Value of a 32 or 64 bit integer parameter
+	long long __param_int(SQLSMALLINT _ctype, const char * _value)
+	{
+		switch(_ctype)
+		{
+		case SQL_C_SLONG:
+		case SQL_C_LONG:	return *(const SQLINTEGER *)_value;
+		case SQL_C_ULONG:	return *(const SQLUINTEGER *)_value;
+		case SQL_C_SBIGINT:
+		case SQL_C_UBIGINT:	return *(const long long *)_value;
+		}
+		return 0;
+	}
+
+	// Validate and consume the parameter sets, then open the result if any
+	SQLRETURN __run(mock_stmt * _s, bool _data_sent)
+	{
+		std::map<int, mock_record>::iterator it;
+		if (!_data_sent)
+			for(it = _s->params.begin(); it != _s->params.end(); ++it)
+				if (__is_data_at_exec(it->second.ind))
+				{	// Wait for SQLParamData()/SQLPutData()
+					_s->dae_param = -1;
+					return SQL_NEED_DATA;
+				}
+
+		const SQLULEN sets = _s->paramset_size ? _s->paramset_size : 1;
+		for(SQLULEN row = 0; row < sets; row++)
+		{
+			for(it = _s->params.begin(); it != _s->params.end(); ++it)
+			{
+				mock_record & p = it->second;
+				const bool is_bytes = (p.ctype == SQL_C_CHAR) || (p.ctype == SQL_C_BINARY);
+				const SQLLEN stride = is_bytes ? p.width : __c_type_size(p.ctype);
+				const SQLLEN ind = p.ind ? p.ind[row] : (p.ctype == SQL_C_CHAR ? SQL_NTS : stride);
+				if (!p.ptr && (ind != SQL_NULL_DATA) && !__is_data_at_exec(p.ind))
+					return __fail(_s, "HY009", "Invalid use of null pointer");
+				if ((ind != SQL_NULL_DATA) && (ind != SQL_NTS) && (ind < 0) && !__is_data_at_exec(p.ind))
+					return __fail(_s, "HY090", "Invalid string or buffer length");
+				if (p.ptr && (ind != SQL_NULL_DATA) && !__is_data_at_exec(p.ind))
+					g_param_sum += __param_int(p.ctype, (const char *)p.ptr + row * stride);
+			}
+			if (_s->param_status)
+				_s->param_status[row] = SQL_PARAM_SUCCESS;
+		}
+		if (_s->params_processed)
+			*_s->params_processed = sets;
+
+		_s->dae_param = 0;
+		_s->has_result = _s->select;
+		_s->row_count = _s->select ? -1 : (SQLLEN)sets;
+		if (!_s->select)
+			g_rows_written += (unsigned long)sets;
+		_s->rows = g_config.rows;
+		_s->next_row = 0;
+		_s->cur_row = 0;
+		_s->cur_count = 0;
+		_s->gd_col = 0;
+		strncpy(_s->columns, g_config.columns, sizeof(_s->columns) - 1);
+		_s->columns[sizeof(_s->columns) - 1] = 0;
+		return __ok(_s);
+	}
+
+	mock_stmt * __stmt(SQLHANDLE _h)
+	{
+		mock_stmt * s = (mock_stmt *)_h;
+		return (s && s->kind == hk_stmt) ? s : NULL;
+	}
+}
+
+extern "C"
+{
+	///////////////////////////////////////////////////////////////////////////////////
+	// CONTROL API
+	///////////////////////////////////////////////////////////////////////////////////
+
+	void mock_odbc_configure(const mock_odbc_config * _config)
+	{
+		g_config = *_config;
+	}
+
+	void mock_odbc_defaults(mock_odbc_config * _config)
+	{
+		static const mock_odbc_config defaults = { 1000, "ibds", 32, 4096, 0, 0, 0, 0 };
+		*_config = defaults;
+	}
+
+	unsigned long mock_odbc_calls()			{	return g_calls;	}
+	unsigned long mock_odbc_rows_written()	{	return g_rows_written;	}
+	unsigned long long mock_odbc_bytes_put()	{	return g_bytes_put;	}
+	long long mock_odbc_param_sum()	{	return g_param_sum;	}
+	unsigned long mock_odbc_commits()		{	return g_commits;	}
+
+	void mock_odbc_reset_counters()
+	{
+		g_calls = 0;
+		g_rows_written = 0;
+		g_bytes_put = 0;
+		g_param_sum = 0;
+		g_commits = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// HANDLES
+	///////////////////////////////////////////////////////////////////////////////////
+
+	SQLRETURN SQLAllocHandle(SQLSMALLINT _type, SQLHANDLE _input, SQLHANDLE * _output)
+	{
+		__mock_call();
+		switch(_type)
+		{
+		case SQL_HANDLE_ENV:
+			*_output = new mock_handle(hk_env);
+			return SQL_SUCCESS;
+		case SQL_HANDLE_DBC:
+			*_output = new mock_dbc();
+			return SQL_SUCCESS;
+		case SQL_HANDLE_STMT:
+		{
+			mock_dbc * dbc = (mock_dbc *)_input;
+			if (!dbc || !dbc->connected)
+				return SQL_ERROR;
+			mock_stmt * s = new mock_stmt();
+			s->dbc = dbc;
+			*_output = s;
+			return SQL_SUCCESS;
+		}
+		}
+		return SQL_ERROR;
+	}
+
+	SQLRETURN SQLFreeHandle(SQLSMALLINT _type, SQLHANDLE _handle)
+	{
+		__mock_call();
+		if (!_handle)
+			return SQL_INVALID_HANDLE;
+		switch(_type)
+		{
+		case SQL_HANDLE_ENV:	delete (mock_handle *)_handle;	break;
+		case SQL_HANDLE_DBC:	delete (mock_dbc *)_handle;	break;
+		case SQL_HANDLE_STMT:	delete (mock_stmt *)_handle;	break;
+		default:
+			return SQL_ERROR;
+		}
+		return SQL_SUCCESS;
+	}
+
+	SQLRETURN SQLSetEnvAttr(SQLHENV, SQLINTEGER, SQLPOINTER, SQLINTEGER)
+	{
+		__mock_call();
+		return SQL_SUCCESS;
+	}
+
+	SQLRETURN SQLGetEnvAttr(SQLHENV, SQLINTEGER, SQLPOINTER _value, SQLINTEGER, SQLINTEGER *)
+	{
+		__mock_call();
+		if (_value)
+			*(SQLUINTEGER *)_value = 0;
+		return SQL_SUCCESS;
+	}
+
+	SQLRETURN SQLSetConnectAttr(SQLHDBC _dbc, SQLINTEGER _attr, SQLPOINTER _value, SQLINTEGER)
+	{
+		__mock_call();
+		mock_dbc * dbc = (mock_dbc *)_dbc;
+		if (_attr == SQL_ATTR_AUTOCOMMIT)
+			dbc->autocommit = (SQLULEN)_value;
+		return __ok(dbc);
+	}
+
+	SQLRETURN SQLGetConnectAttr(SQLHDBC _dbc, SQLINTEGER _attr, SQLPOINTER _value, SQLINTEGER, SQLINTEGER *)
+	{
+		__mock_call();
+		mock_dbc * dbc = (mock_dbc *)_dbc;
+		if (_attr == SQL_ATTR_AUTOCOMMIT)
+			*(SQLUINTEGER *)_value = (SQLUINTEGER)dbc->autocommit;
+		else if (_attr == SQL_ATTR_CONNECTION_DEAD)
+			*(SQLUINTEGER *)_value = dbc->connected ? SQL_CD_FALSE : SQL_CD_TRUE;
+		else
+			*(SQLUINTEGER *)_value = 0;
+		return __ok(dbc);
+	}
+
+	SQLRETURN SQLConnect(SQLHDBC _dbc, SQLCHAR *, SQLSMALLINT, SQLCHAR *, SQLSMALLINT, SQLCHAR *, SQLSMALLINT)
+	{
+		__mock_call();
+		mock_dbc * dbc = (mock_dbc *)_dbc;
+		dbc->connected = true;
+		return __ok(dbc);
+	}
+
+	SQLRETURN SQLDriverConnect(SQLHDBC _dbc, SQLHWND, SQLCHAR *, SQLSMALLINT, SQLCHAR *, SQLSMALLINT, SQLSMALLINT *, SQLUSMALLINT)
+	{
+		__mock_call();
+		mock_dbc * dbc = (mock_dbc *)_dbc;
+		dbc->connected = true;
+		return __ok(dbc);
+	}
+
+	SQLRETURN SQLDisconnect(SQLHDBC _dbc)
+	{
+		__mock_call();
+		mock_dbc * dbc = (mock_dbc *)_dbc;
+		dbc->connected = false;
+		return __ok(dbc);
+	}
+
+	SQLRETURN SQLEndTran(SQLSMALLINT, SQLHANDLE, SQLSMALLINT _completion)
+	{
+		__mock_call();
+		if (_completion == SQL_COMMIT)
+			g_commits++;
+		return SQL_SUCCESS;
+	}
+
+	SQLRETURN SQLGetDiagRec(SQLSMALLINT, SQLHANDLE _handle, SQLSMALLINT _rec, SQLCHAR * _state,
+		SQLINTEGER * _native, SQLCHAR * _message, SQLSMALLINT _size, SQLSMALLINT * _length)
+	{
+		__mock_call();
+		mock_handle * h = (mock_handle *)_handle;
+		if (!h || _rec != 1 || !h->state[0])
+			return SQL_NO_DATA;
+		if (_state)
+			strcpy((char *)_state, h->state);
+		if (_native)
+			*_native = 0;
+		if (_message && _size > 0)
+		{
+			strncpy((char *)_message, h->message, _size - 1);
+			_message[_size - 1] = 0;
+		}
+		if (_length)
+			*_length = (SQLSMALLINT)strlen(h->message);
+		return SQL_SUCCESS;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// STATEMENTS
+	///////////////////////////////////////////////////////////////////////////////////
+
+	SQLRETURN SQLSetStmtAttr(SQLHSTMT _stmt, SQLINTEGER _attr, SQLPOINTER _value, SQLINTEGER)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		switch(_attr)
+		{
+		case SQL_ATTR_ROW_ARRAY_SIZE:		s->row_array_size = (SQLULEN)_value;	break;
+		case SQL_ATTR_ROWS_FETCHED_PTR:		s->rows_fetched = (SQLULEN *)_value;	break;
+		case SQL_ATTR_ROW_STATUS_PTR:		s->row_status = (SQLUSMALLINT *)_value;	break;
+		case SQL_ATTR_ROW_BIND_OFFSET_PTR:	s->bind_offset = (SQLULEN *)_value;	break;
+		case SQL_ATTR_PARAMSET_SIZE:		s->paramset_size = (SQLULEN)_value;	break;
+		case SQL_ATTR_PARAM_STATUS_PTR:		s->param_status = (SQLUSMALLINT *)_value;	break;
+		case SQL_ATTR_PARAMS_PROCESSED_PTR:	s->params_processed = (SQLULEN *)_value;	break;
+		case SQL_ATTR_ASYNC_ENABLE:			s->async = (SQLULEN)_value;	break;
+		case SQL_ATTR_ROW_BIND_TYPE:
+		case SQL_ATTR_PARAM_BIND_TYPE:
+			if ((SQLULEN)_value != SQL_BIND_BY_COLUMN)
+				return __fail(s, "HYC00", "Only column-wise binding is supported");
+			break;
+		}
+		return __ok(s);
+	}
+
+	SQLRETURN SQLGetStmtAttr(SQLHSTMT _stmt, SQLINTEGER _attr, SQLPOINTER _value, SQLINTEGER, SQLINTEGER *)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		switch(_attr)
+		{
+		case SQL_ATTR_APP_ROW_DESC:		*(SQLHDESC *)_value = &s->ard;	break;
+		case SQL_ATTR_APP_PARAM_DESC:	*(SQLHDESC *)_value = &s->apd;	break;
+		case SQL_ATTR_ROW_ARRAY_SIZE:	*(SQLULEN *)_value = s->row_array_size;	break;
+		case SQL_ATTR_PARAMSET_SIZE:	*(SQLULEN *)_value = s->paramset_size;	break;
+		case SQL_ATTR_ASYNC_ENABLE:		*(SQLULEN *)_value = s->async;	break;
+		default:
+			return __fail(s, "HY092", "Invalid attribute identifier");
+		}
+		return __ok(s);
+	}
+
+	SQLRETURN SQLSetDescField(SQLHDESC _desc, SQLSMALLINT _rec, SQLSMALLINT _field, SQLPOINTER _value, SQLINTEGER)
+	{
+		__mock_call();
+		mock_desc * d = (mock_desc *)_desc;
+		if (!d || d->kind != hk_desc)
+			return SQL_INVALID_HANDLE;
+		mock_record & r = (*d->recs)[_rec];
+		switch(_field)
+		{
+		case SQL_DESC_TYPE:			r.ctype = (SQLSMALLINT)(SQLLEN)_value;	r.ptr = NULL;	break;
+		case SQL_DESC_PRECISION:	r.precision = (SQLSMALLINT)(SQLLEN)_value;	r.ptr = NULL;	break;
+		case SQL_DESC_SCALE:		r.scale = (SQLSMALLINT)(SQLLEN)_value;	r.ptr = NULL;	break;
+		case SQL_DESC_DATA_PTR:		r.ptr = _value;	break;
+		case SQL_DESC_INDICATOR_PTR:
+		case SQL_DESC_OCTET_LENGTH_PTR:	r.ind = (SQLLEN *)_value;	break;
+		}
+		return SQL_SUCCESS;
+	}
+
+	SQLRETURN SQLFreeStmt(SQLHSTMT _stmt, SQLUSMALLINT _option)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		switch(_option)
+		{
+		case SQL_CLOSE:			s->has_result = false;	break;
+		case SQL_UNBIND:		s->bindings.clear();	break;
+		case SQL_RESET_PARAMS:	s->params.clear();	break;
+		}
+		return __ok(s);
+	}
+
+	SQLRETURN SQLCloseCursor(SQLHSTMT _stmt)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->has_result)
+			return __fail(s, "24000", "Invalid cursor state");
+		s->has_result = false;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLCancel(SQLHSTMT _stmt)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		s->async_op = op_none;
+		s->dae_param = 0;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLPrepare(SQLHSTMT _stmt, SQLCHAR * _sql, SQLINTEGER _len)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		s->prepared = true;
+		s->select = __is_select(_sql, _len);
+		s->has_result = false;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLExecute(SQLHSTMT _stmt)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->prepared)
+			return __fail(s, "HY010", "Function sequence error");
+		if (s->has_result)
+			return __fail(s, "24000", "Invalid cursor state");
+		if (__async_pending(s, op_execute))
+			return SQL_STILL_EXECUTING;
+		return __run(s, false);
+	}
+
+	SQLRETURN SQLExecDirect(SQLHSTMT _stmt, SQLCHAR * _sql, SQLINTEGER _len)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (s->has_result)
+			return __fail(s, "24000", "Invalid cursor state");
+		if (__async_pending(s, op_exec_direct))
+			return SQL_STILL_EXECUTING;
+		s->select = __is_select(_sql, _len);
+		return __run(s, false);
+	}
+
+	SQLRETURN SQLParamData(SQLHSTMT _stmt, SQLPOINTER * _value)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->dae_param)
+			return __fail(s, "HY010", "Function sequence error");
+
+		// Ask for the next data-at-execution parameter
+		std::map<int, mock_record>::iterator it;
+		for(it = s->params.begin(); it != s->params.end(); ++it)
+			if (__is_data_at_exec(it->second.ind) && (it->first > s->dae_param))
+			{
+				s->dae_param = it->first;
+				if (_value)
+					*_value = it->second.ptr;
+				return SQL_NEED_DATA;
+			}
+
+		// All data were sent, execute
+		return __run(s, true);
+	}
+
+	SQLRETURN SQLPutData(SQLHSTMT _stmt, SQLPOINTER _data, SQLLEN _len)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (s->dae_param <= 0)
+			return __fail(s, "HY010", "Function sequence error");
+		if (!_data && _len > 0)
+			return __fail(s, "HY009", "Invalid use of null pointer");
+		if (_len > 0)
+			g_bytes_put += (unsigned long long)_len;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLRowCount(SQLHSTMT _stmt, SQLLEN * _count)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		*_count = s->row_count;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLMoreResults(SQLHSTMT)
+	{
+		__mock_call();
+		return SQL_NO_DATA;
+	}
+
+	SQLRETURN SQLNumResultCols(SQLHSTMT _stmt, SQLSMALLINT * _count)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		*_count = s->has_result ? (SQLSMALLINT)__column_count(s) : 0;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLDescribeCol(SQLHSTMT _stmt, SQLUSMALLINT _col, SQLCHAR * _name, SQLSMALLINT _size,
+		SQLSMALLINT * _name_len, SQLSMALLINT * _type, SQLULEN * _col_size, SQLSMALLINT * _digits, SQLSMALLINT * _nullable)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->has_result || _col < 1 || _col > __column_count(s))
+			return __fail(s, "07009", "Invalid descriptor index");
+
+		const char c = s->columns[_col - 1];
+		char name[16];
+		int len = snprintf(name, sizeof(name), "COL%u", (unsigned)_col);
+		if (_name && _size > 0)
+		{
+			strncpy((char *)_name, name, _size - 1);
+			_name[_size - 1] = 0;
+		}
+		if (_name_len)	*_name_len = (SQLSMALLINT)len;
+		if (_type)		*_type = __column_sqltype(c);
+		if (_col_size)	*_col_size = __column_size(c);
+		if (_digits)	*_digits = __column_digits(c);
+		if (_nullable)	*_nullable = (g_config.null_every > 0) ? SQL_NULLABLE : SQL_NO_NULLS;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLColAttribute(SQLHSTMT _stmt, SQLUSMALLINT _col, SQLUSMALLINT _field, SQLPOINTER,
+		SQLSMALLINT, SQLSMALLINT *, SQLLEN * _num_attr)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->has_result || _col < 1 || _col > __column_count(s))
+			return __fail(s, "07009", "Invalid descriptor index");
+		const char c = s->columns[_col - 1];
+		switch(_field)
+		{
+		case SQL_DESC_UNSIGNED:
+			if (_num_attr) *_num_attr = SQL_FALSE;
+			return __ok(s);
+		case SQL_DESC_NULLABLE:
+			if (_num_attr) *_num_attr = (g_config.null_every > 0) ? SQL_NULLABLE : SQL_NO_NULLS;
+			return __ok(s);
+		case SQL_DESC_TYPE:
+			if (_num_attr) *_num_attr = __column_sqltype(c);
+			return __ok(s);
+		}
+		return __fail(s, "HY091", "Invalid descriptor field identifier");
+	}
+
+	SQLRETURN SQLBindCol(SQLHSTMT _stmt, SQLUSMALLINT _col, SQLSMALLINT _ctype, SQLPOINTER _ptr, SQLLEN _width, SQLLEN * _ind)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!_ptr)
+		{	// Unbind column
+			s->bindings.erase(_col);
+			return __ok(s);
+		}
+		mock_record & r = s->bindings[_col];
+		r.ctype = _ctype;
+		r.ptr = _ptr;
+		r.width = _width;
+		r.ind = _ind;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLBindParameter(SQLHSTMT _stmt, SQLUSMALLINT _num, SQLSMALLINT _io, SQLSMALLINT _ctype,
+		SQLSMALLINT _sqltype, SQLULEN _size, SQLSMALLINT _digits, SQLPOINTER _ptr, SQLLEN _buflen, SQLLEN * _ind)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (_io != SQL_PARAM_INPUT)
+			return __fail(s, "HYC00", "Only input parameters are supported");
+		mock_record & r = s->params[_num];
+		r.ctype = _ctype;
+		r.sqltype = _sqltype;
+		r.precision = (SQLSMALLINT)_size;
+		r.scale = _digits;
+		r.ptr = _ptr;
+		r.width = _buflen;
+		r.ind = _ind;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLFetch(SQLHSTMT _stmt)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->has_result)
+			return __fail(s, "24000", "Invalid cursor state");
+		if (__async_pending(s, op_fetch))
+			return SQL_STILL_EXECUTING;
+
+		const SQLULEN array_size = s->row_array_size ? s->row_array_size : 1;
+		long n = s->rows - s->next_row;
+		if (n > (long)array_size)
+			n = (long)array_size;
+
+		s->cur_row = s->next_row;
+		s->cur_count = (n > 0) ? n : 0;
+		s->pos = 0;
+		s->gd_col = 0;
+		if (s->rows_fetched)
+			*s->rows_fetched = (SQLULEN)s->cur_count;
+		if (n <= 0)
+			return SQL_NO_DATA;
+		s->next_row += n;
+
+		const SQLULEN offset = s->bind_offset ? *s->bind_offset : 0;
+		SQLRETURN rc = SQL_SUCCESS;
+		std::map<int, mock_record>::iterator it;
+		for(it = s->bindings.begin(); it != s->bindings.end(); ++it)
+		{
+			mock_record & b = it->second;
+			if (!b.ptr || it->first > __column_count(s))
+				continue;
+			const SQLLEN stride = ((b.ctype == SQL_C_CHAR) || (b.ctype == SQL_C_BINARY)) ? b.width : __c_type_size(b.ctype);
+			for(long k = 0; k < n; k++)
+			{
+				char * target = (char *)b.ptr + offset + k * stride;
+				SQLLEN * ind = b.ind ? (SQLLEN *)((char *)(b.ind + k) + offset) : NULL;
+				SQLRETURN crc = __convert(s, s->cur_row + k, it->first, b.ctype, &b, target, b.width, ind, NULL);
+				if (crc == SQL_ERROR)
+					return crc;
+				if (crc == SQL_SUCCESS_WITH_INFO)
+					rc = crc;
+			}
+		}
+		if (s->row_status)
+			for(SQLULEN k = 0; k < array_size; k++)
+				s->row_status[k] = ((long)k < n) ? SQL_ROW_SUCCESS : SQL_ROW_NOROW;
+		return rc;
+	}
+
+	SQLRETURN SQLSetPos(SQLHSTMT _stmt, SQLSETPOSIROW _row, SQLUSMALLINT _op, SQLUSMALLINT)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (_op != SQL_POSITION || _row < 1 || (long)_row > s->cur_count)
+			return __fail(s, "HY107", "Row value out of range");
+		s->pos = (long)_row - 1;
+		s->gd_col = 0;
+		return __ok(s);
+	}
+
+	SQLRETURN SQLGetData(SQLHSTMT _stmt, SQLUSMALLINT _col, SQLSMALLINT _ctype, SQLPOINTER _target, SQLLEN _buflen, SQLLEN * _ind)
+	{
+		__mock_call();
+		mock_stmt * s = __stmt(_stmt);
+		if (!s)
+			return SQL_INVALID_HANDLE;
+		if (!s->has_result || s->cur_count == 0)
+			return __fail(s, "24000", "Invalid cursor state");
+		if (_col < 1 || _col > __column_count(s))
+			return __fail(s, "07009", "Invalid descriptor index");
+
+		if (s->gd_col != _col)
+		{	// Start a new column
+			s->gd_col = _col;
+			s->gd_offset = 0;
+			s->gd_done = false;
+		}
+		else if (s->gd_done)
+			return SQL_NO_DATA;
+
+		std::map<int, mock_record>::iterator it = s->bindings.find(_col);
+		const mock_record * rec = (it != s->bindings.end()) ? &it->second : NULL;
+		SQLRETURN rc = __convert(s, s->cur_row + s->pos, _col, _ctype, rec, _target, _buflen, _ind, &s->gd_offset);
+		if (rc == SQL_SUCCESS)
+			s->gd_done = true;
+		return rc;
+	}
+}
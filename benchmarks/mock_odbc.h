@@ -0,0 +1,87 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+/*
+	Control interface of the in-process ODBC stub (mock_odbc.cpp).
+
+	Linking mock_odbc.cpp instead of an ODBC driver manager turns every
+	ODBC call of tiodbc into a cheap function call over synthetic data,
+	so what is left to measure is the cost of tiodbc itself.
+*/
+
+#ifndef _TIODBC_MOCK_ODBC_H_DEFINED_
+#define _TIODBC_MOCK_ODBC_H_DEFINED_
+
+#include <sql.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! Shape of the synthetic result set produced by every SELECT
+struct mock_odbc_config
+{
+	long rows;				//!< Rows of every result set
+	const char * columns;	//!< One letter per column (see mock_odbc.cpp)
+	long string_width;		//!< Width of CHAR/VARCHAR/VARBINARY columns
+	long lob_size;			//!< Length of LONGVARCHAR values
+	long null_every;		//!< Every Nth row is NULL in all columns (0 = never)
+	long latency_ns;		//!< Injected latency of every ODBC call
+	long async_polls;		//!< SQL_STILL_EXECUTING returns before an async call completes
+	long latency_sleeps;	//!< Non-zero to sleep the latency (a network round trip) instead of spinning
+};
+
+//! Replace the active configuration
+void mock_odbc_configure(const struct mock_odbc_config * _config);
+
+//! Get the default configuration
+void mock_odbc_defaults(struct mock_odbc_config * _config);
+
+//! Total ODBC calls served since last reset
+unsigned long mock_odbc_calls();
+
+//! Rows received through parameters since last reset
+unsigned long mock_odbc_rows_written();
+
+//! Bytes received through SQLPutData since last reset
+unsigned long long mock_odbc_bytes_put();
+
+//! Sum of the integer parameter values received since last reset
+long long mock_odbc_param_sum();
+
+//! Commits received since last reset
+unsigned long mock_odbc_commits();
+
+//! Reset counters
+void mock_odbc_reset_counters();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !_TIODBC_MOCK_ODBC_H_DEFINED_
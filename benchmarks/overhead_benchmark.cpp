@@ -0,0 +1,486 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+// Overhead of TinyODBC itself, measured over the in-process ODBC stub
+//
+// Usage: tiodbc_benchmark_overhead [output.json] [rows] [latency_ns] [runs]
+//
+// Every case reads or writes rows of synthetic data (INTEGER, BIGINT, DOUBLE,
+// VARCHAR(32)) and reports nanoseconds, ODBC calls and heap allocations per
+// row. The "raw_odbc" cases do the same work with plain ODBC calls, the
+// difference from them is what tiodbc adds. latency_ns is spent in every
+// ODBC call to see how the call count translates to time on a real driver.
+// The "fetch_work" cases always run with a network latency (a sleep) and
+// some work per row, the situation where prefetching rowsets in background
+// pays off.
+
+#include "../tiodbc.hpp"
+#include "bench_common.hpp"
+#include "mock_odbc.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std;
+using tiodbc_bench::now;
+using tiodbc_bench::result;
+
+// Count heap allocations of the whole program, threads of prefetching included
+namespace
+{
+	std::atomic<unsigned long> g_allocations(0);
+}
+
+void * operator new(size_t _size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	void * p = malloc(_size?_size:1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void * operator new[](size_t _size)
+{
+	return operator new(_size);
+}
+
+void operator delete(void * _p) throw()
+{
+	free(_p);
+}
+
+void operator delete[](void * _p) throw()
+{
+	free(_p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void * _p, size_t) throw()
+{
+	free(_p);
+}
+
+void operator delete[](void * _p, size_t) throw()
+{
+	free(_p);
+}
+#endif
+
+namespace
+{
+	long rows = 100000;
+	long latency_ns = 0;
+	int runs = 5;
+
+	// Driver latency and application work of the "fetch_work" cases
+	const long work_latency_ns = 50000;
+	const int work_rounds = 200;
+
+	const char * const select_sql = "SELECT id, big, amount, label FROM t";
+	const char * const insert_sql = "INSERT INTO t (id, big, amount, label) VALUES(?, ?, ?, ?)";
+
+	// Check the return code of an ODBC call
+	inline bool succeeded(SQLRETURN _rc)
+	{
+		return (_rc == SQL_SUCCESS) || (_rc == SQL_SUCCESS_WITH_INFO);
+	}
+
+	// Report an error and quit
+	void fail(const string & _what, const string & _error)
+	{
+		cerr << "Error: " << _what << endl << _error << endl;
+		exit(1);
+	}
+
+	// Configure the shape of result sets
+	void configure(long _latency_ns, bool _sleep = false)
+	{
+		mock_odbc_config cfg;
+		mock_odbc_defaults(&cfg);
+		cfg.rows = rows;
+		cfg.columns = "ibds";
+		cfg.string_width = 32;
+		cfg.latency_ns = _latency_ns;
+		cfg.latency_sleeps = _sleep?1:0;
+		mock_odbc_configure(&cfg);
+	}
+
+	// A case that processes _rows rows in every run
+	typedef long (*bench_func)(tiodbc::connection & _conn);
+
+	// Run a case and keep its time, calls and allocations per row
+	void run_case(tiodbc::connection & _conn, const string & _name, const string & _mode,
+		bench_func _func, vector<result> & _results)
+	{
+		result r(_name, _mode, rows, 32, rows);
+		unsigned long calls = 0, allocations = 0;
+		for(int run = 0;run < runs;run++)
+		{
+			mock_odbc_reset_counters();
+			unsigned long allocations_before = g_allocations;
+			double start = now();
+			long done = _func(_conn);
+			r.seconds.push_back(now() - start);
+			calls = mock_odbc_calls();
+			allocations = g_allocations - allocations_before;
+			if (done != rows)
+			{
+				ostringstream msg;
+				msg << "expected " << rows << " rows, got " << done;
+				fail(_name + " " + _mode, msg.str());
+			}
+		}
+		r.extra.push_back(make_pair(string("odbc_calls_per_op"), (double)calls / rows));
+		r.extra.push_back(make_pair(string("allocations_per_op"), (double)allocations / rows));
+		_results.push_back(r);
+		cerr << _name << " " << _mode << ": " << r.median() * 1e9 / rows << " ns/row" << endl;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// FETCH CASES
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Plain ODBC: SQLFetch and SQLGetData of every column
+	long fetch_raw_odbc(tiodbc::connection & _conn)
+	{
+		HSTMT stmt;
+		if (!succeeded(SQLAllocHandle(SQL_HANDLE_STMT, _conn.native_dbc_handle(), &stmt)))
+			fail("raw_odbc", "cannot allocate statement");
+		if (!succeeded(SQLExecDirect(stmt, (SQLCHAR *)select_sql, SQL_NTS)))
+			fail("raw_odbc", "cannot execute");
+
+		long n = 0;
+		long long checksum = 0;
+		SQLINTEGER id;
+		SQLBIGINT big;
+		double amount;
+		char label[64];
+		SQLLEN ind;
+		while(SQLFetch(stmt) == SQL_SUCCESS)
+		{
+			SQLGetData(stmt, 1, SQL_C_SLONG, &id, sizeof(id), &ind);
+			SQLGetData(stmt, 2, SQL_C_SBIGINT, &big, sizeof(big), &ind);
+			SQLGetData(stmt, 3, SQL_C_DOUBLE, &amount, sizeof(amount), &ind);
+			SQLGetData(stmt, 4, SQL_C_CHAR, label, sizeof(label), &ind);
+			checksum += id + big + (long long)amount + ind;
+			n++;
+		}
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return (checksum == -1)?-1:n;
+	}
+
+	// Row by row, text through as_string()
+	long fetch_as_string(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += stmt.field(1).as_long() + stmt.field(2).as_int64()
+				+ (long long)stmt.field(3).as_double() + (long long)stmt.field(4).as_string().size();
+			n++;
+		}
+		return (checksum == -1)?-1:n;
+	}
+
+	// Row by row, text through as_string_view()
+	long fetch_as_string_view(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += stmt.field(1).as_long() + stmt.field(2).as_int64()
+				+ (long long)stmt.field(3).as_double() + (long long)stmt.field(4).as_string_view().size();
+			n++;
+		}
+		return (checksum == -1)?-1:n;
+	}
+
+	// Block cursor of 256 rows
+	long fetch_rowset(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		stmt.set_rowset_size(256);
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += stmt.field(1).as_long() + stmt.field(2).as_int64()
+				+ (long long)stmt.field(3).as_double() + (long long)stmt.field(4).as_string_view().size();
+			n++;
+		}
+		return (checksum == -1)?-1:n;
+	}
+
+	// Whole result set in columns
+	long fetch_columnar(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		tiodbc::columnar_result res;
+		if (!stmt.fetch_columnar(res))
+			fail("fetch_columnar", stmt.last_error());
+		return (long)res.rows;
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Typed rows
+	long fetch_typed_rows(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		long long checksum = 0;
+		for(const auto & row : stmt.rows<int, long long, double, tiodbc::_tstring>())
+		{
+			checksum += std::get<0>(row) + std::get<1>(row) + (long long)std::get<2>(row) + (long long)std::get<3>(row).size();
+			n++;
+		}
+		return (checksum == -1)?-1:n;
+	}
+
+	// Block cursor of 256 rows, next rowset fetched in background
+	long fetch_rowset_prefetch(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		stmt.set_rowset_size(256);
+		stmt.set_prefetch(1);
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += stmt.field(1).as_long() + stmt.field(2).as_int64()
+				+ (long long)stmt.field(3).as_double() + (long long)stmt.field(4).as_string_view().size();
+			n++;
+		}
+		return (checksum == -1)?-1:n;
+	}
+
+	// Simulated processing of a row by the application
+	unsigned long long process_row(unsigned long long _value)
+	{
+		for(int i = 0;i < work_rounds;i++)
+			_value = _value * 6364136223846793005ULL + 1442695040888963407ULL;
+		return _value;
+	}
+
+	// Block cursor of 256 rows with work per row, optionally prefetched
+	long fetch_rowset_work(tiodbc::connection & _conn, unsigned long _prefetch)
+	{
+		tiodbc::statement stmt;
+		stmt.set_rowset_size(256);
+		stmt.set_prefetch(_prefetch);
+		if (!stmt.execute_direct(_conn, select_sql))
+			fail("fetch", stmt.last_error());
+
+		long n = 0;
+		unsigned long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += process_row(stmt.field(1).as_long() + stmt.field(2).as_int64()
+				+ (long long)stmt.field(3).as_double() + (long long)stmt.field(4).as_string_view().size());
+			n++;
+		}
+		return (checksum == 1)?-1:n;
+	}
+
+	// Driver latency and work per row, fetched in the same thread
+	long fetch_work(tiodbc::connection & _conn)
+	{
+		return fetch_rowset_work(_conn, 0);
+	}
+
+	// Driver latency and work per row, next rowset fetched in background
+	long fetch_work_prefetch(tiodbc::connection & _conn)
+	{
+		return fetch_rowset_work(_conn, 1);
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// INSERT CASES
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Plain ODBC: parameters bound once, one SQLExecute per row
+	long insert_raw_odbc(tiodbc::connection & _conn)
+	{
+		HSTMT stmt;
+		if (!succeeded(SQLAllocHandle(SQL_HANDLE_STMT, _conn.native_dbc_handle(), &stmt)))
+			fail("raw_odbc", "cannot allocate statement");
+		if (!succeeded(SQLPrepare(stmt, (SQLCHAR *)insert_sql, SQL_NTS)))
+			fail("raw_odbc", "cannot prepare");
+
+		SQLINTEGER id;
+		SQLBIGINT big;
+		double amount;
+		char label[33] = "abcdefghijklmnopqrstuvwxyzabcdef";
+		SQLLEN id_ind = 0, big_ind = 0, amount_ind = 0, label_ind = SQL_NTS;
+		SQLBindParameter(stmt, 1, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &id, 0, &id_ind);
+		SQLBindParameter(stmt, 2, SQL_PARAM_INPUT, SQL_C_SBIGINT, SQL_BIGINT, 0, 0, &big, 0, &big_ind);
+		SQLBindParameter(stmt, 3, SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_DOUBLE, 0, 0, &amount, 0, &amount_ind);
+		SQLBindParameter(stmt, 4, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, 32, 0, label, sizeof(label), &label_ind);
+
+		long n = 0;
+		for(;n < rows;n++)
+		{
+			id = (SQLINTEGER)n;
+			big = n * 3;
+			amount = n * 0.25;
+			label[n % 32] = (char)('a' + n % 26);
+			if (!succeeded(SQLExecute(stmt)))
+				fail("raw_odbc", "cannot execute");
+		}
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return n;
+	}
+
+	// param().set_as_*() and execute() per row
+	long insert_param(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.prepare(_conn, insert_sql))
+			fail("insert", stmt.last_error());
+
+		string label = "abcdefghijklmnopqrstuvwxyzabcdef";
+		long n = 0;
+		for(;n < rows;n++)
+		{
+			label[n % 32] = (char)('a' + n % 26);
+			stmt.param(1).set_as_long(n);
+			stmt.param(2).set_as_int64(n * 3);
+			stmt.param(3).set_as_double(n * 0.25);
+			stmt.param(4).set_as_string(label);
+			if (!stmt.execute())
+				fail("insert", stmt.last_error());
+		}
+		return n;
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Variadic execute() per row
+	long insert_variadic(tiodbc::connection & _conn)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.prepare(_conn, insert_sql))
+			fail("insert", stmt.last_error());
+
+		string label = "abcdefghijklmnopqrstuvwxyzabcdef";
+		long n = 0;
+		for(;n < rows;n++)
+		{
+			label[n % 32] = (char)('a' + n % 26);
+			if (!stmt.execute(n, (long long)n * 3, n * 0.25, label))
+				fail("insert", stmt.last_error());
+		}
+		return n;
+	}
+#endif
+}
+
+int main(int argc, char ** argv)
+{
+	string output;
+	if (argc > 1)
+		output = argv[1];
+	if ((argc > 2) && (atol(argv[2]) > 0))
+		rows = atol(argv[2]);
+	if (argc > 3)
+		latency_ns = atol(argv[3]);
+	if ((argc > 4) && (atoi(argv[4]) > 0))
+		runs = atoi(argv[4]);
+
+	configure(latency_ns);
+	tiodbc::connection conn;
+	if (!conn.connect("mock", "", ""))
+		fail("cannot connect", conn.last_error());
+
+	vector<result> results;
+	run_case(conn, "fetch", "raw_odbc", fetch_raw_odbc, results);
+	run_case(conn, "fetch", "as_string", fetch_as_string, results);
+	run_case(conn, "fetch", "as_string_view", fetch_as_string_view, results);
+	run_case(conn, "fetch", "rowset_256", fetch_rowset, results);
+	run_case(conn, "fetch", "columnar", fetch_columnar, results);
+#ifdef TIODBC_HAS_CXX11
+	run_case(conn, "fetch", "typed_rows", fetch_typed_rows, results);
+	run_case(conn, "fetch", "rowset_256_prefetch", fetch_rowset_prefetch, results);
+
+	configure(work_latency_ns, true);
+	run_case(conn, "fetch_work", "rowset_256", fetch_work, results);
+	run_case(conn, "fetch_work", "rowset_256_prefetch", fetch_work_prefetch, results);
+	configure(latency_ns);
+#endif
+	run_case(conn, "insert", "raw_odbc", insert_raw_odbc, results);
+	run_case(conn, "insert", "param_execute", insert_param, results);
+#ifdef TIODBC_HAS_CXX11
+	run_case(conn, "insert", "variadic_execute", insert_variadic, results);
+#endif
+
+	vector<pair<string, string> > context;
+	ostringstream latency;
+	latency << latency_ns;
+	context.push_back(make_pair(string("driver"), string("mock_odbc")));
+	context.push_back(make_pair(string("latency_ns"), latency.str()));
+	ostringstream work;
+	work << work_latency_ns << " ns sleeping latency, " << work_rounds << " rounds per row";
+	context.push_back(make_pair(string("fetch_work"), work.str()));
+	context.push_back(make_pair(string("columns"), string("INTEGER, BIGINT, DOUBLE, VARCHAR(32)")));
+
+	if (output.empty())
+		tiodbc_bench::write_json(cout, "overhead", context, results);
+	else
+	{
+		ofstream out(output.c_str());
+		if (!out)
+			fail("cannot write " + output, "");
+		tiodbc_bench::write_json(out, "overhead", context, results);
+	}
+	return 0;
+}
@@ -0,0 +1,238 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+// Throughput benchmark of TinyODBC against a local file-backed Data Source
+//
+// Usage: tiodbc_benchmark_sqlite [dsn] [output.json] [runs]
+//
+// The Data Source is expected to be a SQLite database through unixODBC, e.g.
+// in odbc.ini:
+//
+//    [tiodbc_bench]
+//    Driver = SQLite3
+//    Database = /tmp/tiodbc_bench.db
+//
+// Any other Data Source that understands the CREATE/DROP/INSERT/SELECT
+// statements below works as well. Results are written as JSON to the
+// output file (default: standard output).
+
+#include "../tiodbc.hpp"
+#include "bench_common.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std;
+using tiodbc_bench::now;
+using tiodbc_bench::result;
+
+namespace
+{
+	const long row_counts[] = {1000, 10000, 100000};
+	const long widths[] = {16, 256};
+
+	string dsn = "tiodbc_bench";
+	int runs = 3;
+
+	// Report an error and quit
+	void fail(const string & _what, const string & _error)
+	{
+		cerr << "Error: " << _what << endl << _error << endl;
+		exit(1);
+	}
+
+	// Name of the table with text of _width
+	string table_name(long _width)
+	{
+		ostringstream name;
+		name << "tiodbc_bench_" << _width;
+		return name.str();
+	}
+
+	// Create an empty table
+	void create_table(tiodbc::connection & _conn, long _width)
+	{
+		tiodbc::statement stmt;
+		stmt.execute_direct(_conn, "DROP TABLE IF EXISTS " + table_name(_width));
+
+		ostringstream sql;
+		sql << "CREATE TABLE " << table_name(_width) << " (id INTEGER, amount DOUBLE, label VARCHAR(" << _width << "))";
+		if (!stmt.execute_direct(_conn, sql.str()))
+			fail("cannot create table", stmt.last_error());
+	}
+
+	// Insert _rows rows through a prepared statement, one execution per row
+	double insert_rows(tiodbc::connection & _conn, long _rows, long _width)
+	{
+		tiodbc::statement stmt;
+		if (!stmt.prepare(_conn, "INSERT INTO " + table_name(_width) + " (id, amount, label) VALUES(?, ?, ?)"))
+			fail("cannot prepare insert", stmt.last_error());
+
+		string label(_width, 'x');
+		double start = now();
+		for(long i = 0;i < _rows;i++)
+		{
+			label[i % _width] = (char)('a' + i % 26);
+			stmt.param(1).set_as_long(i);
+			stmt.param(2).set_as_double(i * 0.25);
+			stmt.param(3).set_as_string(label);
+			if (!stmt.execute())
+				fail("cannot insert", stmt.last_error());
+		}
+		return now() - start;
+	}
+
+	// Read all rows and touch every field, returns duration
+	double fetch_rows(tiodbc::connection & _conn, long _rows, long _width, unsigned long _rowset)
+	{
+		tiodbc::statement stmt;
+		if (_rowset > 1)
+			stmt.set_rowset_size(_rowset);
+
+		double start = now();
+		if (!stmt.execute_direct(_conn, "SELECT id, amount, label FROM " + table_name(_width)))
+			fail("cannot select", stmt.last_error());
+
+		long rows = 0;
+		long long checksum = 0;
+		while(stmt.fetch_next())
+		{
+			checksum += stmt.field(1).as_long();
+			checksum += (long long)stmt.field(2).as_double();
+			checksum += (long long)stmt.field(3).as_string_view().size();
+			rows++;
+		}
+		double elapsed = now() - start;
+
+		if (rows != _rows)
+		{
+			ostringstream msg;
+			msg << "expected " << _rows << " rows, got " << rows << " (checksum " << checksum << ")";
+			fail("wrong number of rows", msg.str());
+		}
+		return elapsed;
+	}
+
+	// Prepare the same query again and again
+	void bench_prepare(tiodbc::connection & _conn, vector<result> & _results)
+	{
+		const long count = 1000;
+		result r("prepare", "select", 0, 0, count);
+		for(int run = 0;run < runs;run++)
+		{
+			tiodbc::statement stmt;
+			double start = now();
+			for(long i = 0;i < count;i++)
+				if (!stmt.prepare(_conn, "SELECT id, amount, label FROM " + table_name(widths[0]) + " WHERE id = ?"))
+					fail("cannot prepare", stmt.last_error());
+			r.seconds.push_back(now() - start);
+		}
+		_results.push_back(r);
+	}
+
+	// Connect and disconnect again and again
+	void bench_connect(vector<result> & _results)
+	{
+		const long count = 50;
+		result r("connect", "connect_disconnect", 0, 0, count);
+		for(int run = 0;run < runs;run++)
+		{
+			tiodbc::connection conn;
+			double start = now();
+			for(long i = 0;i < count;i++)
+			{
+				if (!conn.connect(dsn, "", ""))
+					fail("cannot connect to " + dsn, conn.last_error());
+				conn.disconnect();
+			}
+			r.seconds.push_back(now() - start);
+		}
+		_results.push_back(r);
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	string output;
+	if (argc > 1)
+		dsn = argv[1];
+	if (argc > 2)
+		output = argv[2];
+	if ((argc > 3) && (atoi(argv[3]) > 0))
+		runs = atoi(argv[3]);
+
+	tiodbc::connection conn;
+	if (!conn.connect(dsn, "", ""))
+		fail("cannot connect to " + dsn, conn.last_error());
+
+	// Keep the disk out of the measurements as much as possible (SQLite only)
+	tiodbc::statement pragma;
+	pragma.execute_direct(conn, "PRAGMA synchronous = OFF");
+	pragma.execute_direct(conn, "PRAGMA journal_mode = MEMORY");
+
+	vector<result> results;
+	for(size_t w = 0;w < sizeof(widths) / sizeof(widths[0]);w++)
+		for(size_t n = 0;n < sizeof(row_counts) / sizeof(row_counts[0]);n++)
+		{
+			long rows = row_counts[n], width = widths[w];
+			result insert("insert", "param_execute", rows, width, rows);
+			result fetch("fetch", "row_by_row", rows, width, rows);
+			result fetch_rowset("fetch", "rowset_256", rows, width, rows);
+			for(int run = 0;run < runs;run++)
+			{
+				create_table(conn, width);
+				insert.seconds.push_back(insert_rows(conn, rows, width));
+				fetch.seconds.push_back(fetch_rows(conn, rows, width, 1));
+				fetch_rowset.seconds.push_back(fetch_rows(conn, rows, width, 256));
+			}
+			results.push_back(insert);
+			results.push_back(fetch);
+			results.push_back(fetch_rowset);
+			cerr << "rows " << rows << " width " << width << " done" << endl;
+		}
+	bench_prepare(conn, results);
+	bench_connect(results);
+
+	vector<pair<string, string> > context;
+	context.push_back(make_pair(string("dsn"), dsn));
+	ostringstream version;
+	version << tiodbc::version_major() << "." << tiodbc::version_minor() << "." << tiodbc::version_revision();
+	context.push_back(make_pair(string("tiodbc_version"), version.str()));
+
+	if (output.empty())
+		tiodbc_bench::write_json(cout, "sqlite", context, results);
+	else
+	{
+		ofstream out(output.c_str());
+		if (!out)
+			fail("cannot write " + output, "");
+		tiodbc_bench::write_json(out, "sqlite", context, results);
+	}
+	return 0;
+}
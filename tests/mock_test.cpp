@@ -0,0 +1,172 @@
+/***************************************************************************
+
+    This file is part of project: TinyODBC
+    TinyODBC is hosted under: http://code.google.com/p/tiodbc/
+
+    Copyright (c) 2008-2011 SqUe <squarious _at_ gmail _dot_ com>
+
+    The MIT Licence
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*****************************************************************************/
+
+// Checks of tiodbc over the in-process ODBC stub
+//
+// Usage: tiodbc_test_mock
+//
+// Every check runs against the synthetic data of mock_odbc.cpp and the
+// program exits with the number of failed checks.
+
+#include "../tiodbc.hpp"
+#include "mock_odbc.h"
+#include <iostream>
+#include <limits.h>
+
+using namespace std;
+
+namespace
+{
+	int g_failures = 0;
+
+	// Report a failed check
+	void check(bool _ok, const char * _what)
+	{
+		if (_ok)
+			return;
+		cerr << "FAILED: " << _what << endl;
+		g_failures++;
+	}
+
+	// Configure the shape of result sets
+	void configure(long _rows, const char * _columns, long _async_polls = 0)
+	{
+		mock_odbc_config cfg;
+		mock_odbc_defaults(&cfg);
+		cfg.rows = _rows;
+		cfg.columns = _columns;
+		cfg.async_polls = _async_polls;
+		mock_odbc_configure(&cfg);
+	}
+
+	// Arrays of long values keep their full range
+	void test_long_arrays(tiodbc::connection & conn)
+	{
+		configure(0, "i");
+		tiodbc::statement stmt(conn, "INSERT INTO t VALUES(?)");
+		std::vector<long> values;
+		values.push_back(LONG_MAX / 3);
+		values.push_back(-5);
+		values.push_back(7);
+		mock_odbc_reset_counters();
+		check(stmt.param(1).set_as_long_array(values) && stmt.execute_batch(3), "execute_batch of longs");
+		check(mock_odbc_param_sum() == (long long)(LONG_MAX / 3) + 2, "values of long array");
+
+		std::vector<unsigned long> uvalues;
+		uvalues.push_back(ULONG_MAX / 4);
+		uvalues.push_back(3);
+		mock_odbc_reset_counters();
+		check(stmt.param(1).set_as_unsigned_long_array(uvalues) && stmt.execute_batch(2), "execute_batch of unsigned longs");
+		check(mock_odbc_param_sum() == (long long)(ULONG_MAX / 4) + 3, "values of unsigned long array");
+	}
+
+	// Statements that outlive their connection
+	void test_statement_outlives_connection()
+	{
+		configure(10, "i");
+		tiodbc::statement stmt;
+		tiodbc::statement cached;
+		tiodbc::connection * p_conn = new tiodbc::connection();
+		check(p_conn->connect("mock", "", ""), "connect");
+		check(stmt.execute_direct(*p_conn, "SELECT * FROM t") && stmt.fetch_next(), "execute on the connection");
+		check(cached.prepare_cached(*p_conn, "SELECT * FROM t"), "prepare_cached on the connection");
+		delete p_conn;
+		check(!stmt.is_open() && !cached.is_open(), "statements are closed with their connection");
+		check(!stmt.fetch_next(), "fetch after the connection is gone");
+		stmt.close();
+	}
+
+	// A cached statement closed in the middle of an asynchronous execution
+	void test_cached_async_close(tiodbc::connection & conn)
+	{
+		configure(10, "i", 3);
+		tiodbc::statement stmt;
+		check(stmt.prepare_cached(conn, "SELECT * FROM t"), "prepare_cached");
+		tiodbc::async_result pending = stmt.execute_async();
+		check(!pending.ready(), "asynchronous execution in progress");
+		stmt.close();
+
+		// The handle comes back from the cache synchronous
+		check(stmt.prepare_cached(conn, "SELECT * FROM t") && stmt.execute(), "execute a cached handle after an asynchronous one");
+		long rows = 0;
+		while(stmt.fetch_next())
+			rows++;
+		check(rows == 10, "rows of the cached handle");
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Asynchronous execution while rowsets are prefetched
+	void test_execute_async_prefetch(tiodbc::connection & conn)
+	{
+		configure(1000, "is", 3);
+		tiodbc::statement stmt(conn, "SELECT * FROM t");
+		stmt.set_rowset_size(100);
+		stmt.set_prefetch(2);
+		check(stmt.execute(), "execute with prefetch");
+		for(int i = 0;i < 150;i++)
+			stmt.fetch_next();
+
+		// The cursor is still open, the driver refuses it after the thread is stopped
+		tiodbc::async_result pending = stmt.execute_async();
+		check(pending.wait(1000) && !pending.result(), "execute_async on an open cursor fails");
+		check(stmt.last_error_status_code() == "24000", "execute_async reports the open cursor");
+		tiodbc::columnar_result rest;
+		check(stmt.fetch_columnar(rest), "execute_async stops prefetching");
+
+		// Once the cursor is closed the new result set is prefetched again
+		stmt.free_results();
+		pending = stmt.execute_async();
+		check(pending.wait(1000) && pending.result(), "execute_async after free_results");
+		long rows = 0;
+		while(stmt.fetch_next())
+			rows++;
+		check(rows == 1000, "rows of asynchronous execution with prefetch");
+	}
+#endif // TIODBC_HAS_CXX11
+}
+
+int main()
+{
+	tiodbc::connection conn;
+	if (!conn.connect("mock", "", ""))
+	{
+		cerr << "Cannot connect to the ODBC stub: " << conn.last_error() << endl;
+		return 1;
+	}
+
+	test_long_arrays(conn);
+	test_statement_outlives_connection();
+	test_cached_async_close(conn);
+#ifdef TIODBC_HAS_CXX11
+	test_execute_async_prefetch(conn);
+#endif // TIODBC_HAS_CXX11
+
+	if (!g_failures)
+		cout << "All checks passed" << endl;
+	return g_failures;
+}
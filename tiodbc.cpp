@@ -28,12 +28,53 @@
 
 #include "./tiodbc.hpp"
 #include <string.h>
-#include <memory>
+#include <stdlib.h>
+#include <limits>
+#include <sstream>
+#include <ostream>
+#include <istream>
+#include <fstream>
+#include <stdio.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
 
 // Macro for easy return code check
 #define TIODBC_SUCCESS_CODE(rc) \
 	((rc==SQL_SUCCESS)||(rc==SQL_SUCCESS_WITH_INFO))
 
+// Biggest buffer (in bytes) of a single value that will be bound for block fetching
+#ifndef TIODBC_MAX_BOUND_SIZE
+#define TIODBC_MAX_BOUND_SIZE 4096
+#endif
+
+// Size of chunks that data-at-execution parameters are sent in
+#ifndef TIODBC_STREAM_CHUNK_SIZE
+#define TIODBC_STREAM_CHUNK_SIZE 65536
+#endif
+
+// Rows fetched at once by statement::fetch_columnar() when rowset size is 1
+#ifndef TIODBC_COLUMNAR_ROWS
+#define TIODBC_COLUMNAR_ROWS 1024
+#endif
+
+// Instrumentation (odbc_stats), compiled in only if TIODBC_ENABLE_STATS is defined
+#ifdef TIODBC_ENABLE_STATS
+#define TIODBC_STATS_CALL(_owner, _func) \
+	tiodbc::__stats_access::call((_owner), tiodbc::odbc_stats::_func, 1)
+#define TIODBC_STATS_CALLS(_owner, _func, _count) \
+	tiodbc::__stats_access::call((_owner), tiodbc::odbc_stats::_func, (_count))
+#define TIODBC_STATS_ADD(_owner, _field, _value) \
+	tiodbc::__stats_access::add((_owner), &tiodbc::odbc_stats::_field, (unsigned long long)(_value))
+#define TIODBC_STATS_TIMER(_owner, _field) \
+	tiodbc::__stats_timer __stats_timer_##_field((_owner), &tiodbc::odbc_stats::_field)
+#else
+#define TIODBC_STATS_CALL(_owner, _func) ((void)(_owner))
+#define TIODBC_STATS_CALLS(_owner, _func, _count) ((void)(_owner))
+#define TIODBC_STATS_ADD(_owner, _field, _value) ((void)(_owner))
+#define TIODBC_STATS_TIMER(_owner, _field)
+#endif
+
 namespace tiodbc
 {
 	// Current version
@@ -73,41 +114,274 @@ namespace tiodbc
 		return false;
 	}
 
+	// Monotonic clock in nanoseconds
+	unsigned long long __monotonic_ns()
+	{
+#ifdef _WIN32
+		static LARGE_INTEGER freq = {0};
+		LARGE_INTEGER now;
+		if (freq.QuadPart == 0)
+			QueryPerformanceFrequency(&freq);
+		QueryPerformanceCounter(&now);
+		return (unsigned long long)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+	}
+
 	//! @endcond
 
 	///////////////////////////////////////////////////////////////////////////////////
-	// CONNECTION IMPLEMENTATION
+	// ENVIRONMENT IMPLEMENTATION
 	///////////////////////////////////////////////////////////////////////////////////
 
 	//! @cond INTERNAL_FUNCTIONS
 
-	// Allocate HENV and HDBC handles
-	void __allocate_handle(HENV & _env, HDBC & _conn)
+	// The process-wide environment
+	environment * __shared_env = NULL;
+
+	// A flag if the process-wide environment is kept alive forever
+	bool __shared_env_pinned = false;
+
+#ifdef TIODBC_HAS_CXX11
+	// Guards reference counting of environments
+	std::mutex __env_mutex;
+	#define TIODBC_ENV_LOCK() std::lock_guard<std::mutex> __env_lock(__env_mutex)
+#else
+	#define TIODBC_ENV_LOCK()
+#endif
+
+	//! @endcond
+
+	// Default constructor
+	environment::environment()
+		:env_h(NULL),
+		n_refs(0),
+		b_shared(false)
 	{
 		// Allocate enviroment
-		SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &_env);
+		SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &env_h);
 
 		/* We want ODBC 3 support */
-		SQLSetEnvAttr(_env, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0);
+		SQLSetEnvAttr(env_h, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0);
+	}
+
+	// Destructor
+	environment::~environment()
+	{
+		SQLFreeHandle(SQL_HANDLE_ENV, env_h);
+	}
+
+	// Attach a connection to the process-wide environment
+	environment * environment::acquire_shared()
+	{
+		TIODBC_ENV_LOCK();
+		if (!__shared_env)
+		{
+			__shared_env = new environment();
+			__shared_env->b_shared = true;
+		}
+		__shared_env->n_refs++;
+		return __shared_env;
+	}
+
+	// Attach a connection
+	void environment::acquire()
+	{
+		TIODBC_ENV_LOCK();
+		n_refs++;
+	}
+
+	// Detach a connection
+	void environment::release()
+	{
+		TIODBC_ENV_LOCK();
+		if ((--n_refs == 0) && b_shared)
+		{	// Last user of the process-wide environment
+			__shared_env = NULL;
+			delete this;
+		}
+	}
+
+	// Set how the driver manager matches pooled connections
+	bool environment::set_pool_match(bool _relaxed)
+	{
+		RETCODE rc = SQLSetEnvAttr(env_h,
+			SQL_ATTR_CP_MATCH,
+			(SQLPOINTER)(_relaxed?SQL_CP_RELAXED_MATCH:SQL_CP_STRICT_MATCH),
+			SQL_IS_INTEGER);
+		return TIODBC_SUCCESS_CODE(rc);
+	}
+
+	// Enable connection pooling of the driver manager
+	bool environment::enable_driver_pooling(bool _per_environment)
+	{
+		RETCODE rc = SQLSetEnvAttr(SQL_NULL_HANDLE,
+			SQL_ATTR_CONNECTION_POOLING,
+			(SQLPOINTER)(_per_environment?SQL_CP_ONE_PER_HENV:SQL_CP_ONE_PER_DRIVER),
+			SQL_IS_INTEGER);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
 
-		// A connection handle
-		SQLAllocHandle(SQL_HANDLE_DBC, _env, &_conn);	
+		// Keep the process-wide environment (and its pool) alive
+		shared();
+		return true;
+	}
+
+	// Get the process-wide environment
+	environment & environment::shared()
+	{
+		TIODBC_ENV_LOCK();
+		if (!__shared_env)
+		{
+			__shared_env = new environment();
+			__shared_env->b_shared = true;
+		}
+		if (!__shared_env_pinned)
+		{
+			__shared_env->n_refs++;
+			__shared_env_pinned = true;
+		}
+		return *__shared_env;
 	}
 
+	///////////////////////////////////////////////////////////////////////////////////
+	// STATS IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	//! @cond INTERNAL_FUNCTIONS
+#ifdef TIODBC_ENABLE_STATS
+
+	// Access to the counters of connections and statements
+	struct __stats_access
+	{
+		static void call(connection * _conn, odbc_stats::odbc_function _func, unsigned long _count)
+		{
+			_conn->m_stats.calls[_func] += _count;
+		}
+
+		static void call(const statement * _stmt, odbc_stats::odbc_function _func, unsigned long _count)
+		{
+			_stmt->m_stats.calls[_func] += _count;
+			if (_stmt->p_conn)
+				_stmt->p_conn->m_stats.calls[_func] += _count;
+		}
+
+		static void add(const statement * _stmt, unsigned long long odbc_stats::* _field, unsigned long long _value)
+		{
+			_stmt->m_stats.*_field += _value;
+			if (_stmt->p_conn)
+				_stmt->p_conn->m_stats.*_field += _value;
+		}
+	};
+
+	// Adds the wall time of its scope to a timer of statement
+	class __stats_timer
+	{
+	private:
+		const statement * p_stmt;
+		unsigned long long odbc_stats::* p_field;
+		unsigned long long start;
+
+		// NonCopyable
+		__stats_timer(const __stats_timer &);
+		__stats_timer & operator=(const __stats_timer &);
+
+	public:
+		__stats_timer(const statement * _stmt, unsigned long long odbc_stats::* _field)
+			:p_stmt(_stmt), p_field(_field), start(__monotonic_ns()) {}
+
+		~__stats_timer()
+		{
+			__stats_access::add(p_stmt, p_field, __monotonic_ns() - start);
+		}
+	};
+
+#endif // TIODBC_ENABLE_STATS
 	//! @endcond
 
+	// Construct with everything zero
+	odbc_stats::odbc_stats()
+	{
+		reset();
+	}
+
+	// Set everything to zero
+	void odbc_stats::reset()
+	{
+		for(int i = 0;i < function_count;i++)
+			calls[i] = 0;
+		executions = 0;
+		rows_fetched = 0;
+		bytes_fetched = 0;
+		prepare_ns = 0;
+		execute_ns = 0;
+		fetch_ns = 0;
+		convert_ns = 0;
+	}
+
+	// Get the number of calls of all functions
+	unsigned long odbc_stats::total_calls() const
+	{
+		unsigned long total = 0;
+		for(int i = 0;i < function_count;i++)
+			total += calls[i];
+		return total;
+	}
+
+	// Get the name of an ODBC function
+	const char * odbc_stats::function_name(odbc_function _func)
+	{
+		static const char * names[function_count] = {
+			"SQLAllocHandle", "SQLFreeHandle", "SQLConnect", "SQLDisconnect",
+			"SQLPrepare", "SQLExecute", "SQLExecDirect", "SQLParamData", "SQLPutData",
+			"SQLFetch", "SQLGetData", "SQLBindCol", "SQLBindParameter",
+			"SQLNumResultCols", "SQLDescribeCol", "SQLColAttribute", "SQLSetStmtAttr",
+			"SQLSetDescField", "SQLFreeStmt", "SQLCloseCursor", "SQLCancel",
+			"SQLSetConnectAttr", "SQLEndTran"
+		};
+
+		if ((_func < 0) || (_func >= function_count))
+			return "";
+		return names[_func];
+	}
+
+	// Add the counters of another object
+	odbc_stats & odbc_stats::operator+=(const odbc_stats & r)
+	{
+		for(int i = 0;i < function_count;i++)
+			calls[i] += r.calls[i];
+		executions += r.executions;
+		rows_fetched += r.rows_fetched;
+		bytes_fetched += r.bytes_fetched;
+		prepare_ns += r.prepare_ns;
+		execute_ns += r.execute_ns;
+		fetch_ns += r.fetch_ns;
+		convert_ns += r.convert_ns;
+		return *this;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// CONNECTION IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
 
 	// Construct by data source
 	connection::connection(const _tstring & _dsn,
 				const _tstring & _user,
 				const _tstring & _pass)
-		:env_h(NULL),
+		:p_env(environment::acquire_shared()),
 		conn_h(NULL),
-		b_connected(false)
+		b_connected(false),
+		conn_serial(0),
+		stmt_cache_size(32),
+		p_queries(NULL)
 	{
 		
-		// Allocate handles
-		__allocate_handle(env_h, conn_h);
+		// Allocate connection handle
+		TIODBC_STATS_CALL(this, alloc_handle);
+		SQLAllocHandle(SQL_HANDLE_DBC, p_env->native_env_handle(), &conn_h);
 
 		// open connection too
 		connect(_dsn, _user, _pass);
@@ -115,12 +389,32 @@ namespace tiodbc
 
 	// Default constructor
 	connection::connection()
-		:env_h(NULL),
+		:p_env(environment::acquire_shared()),
+		conn_h(NULL),
+		b_connected(false),
+		conn_serial(0),
+		stmt_cache_size(32),
+		p_queries(NULL)
+	{
+		// Allocate connection handle
+		TIODBC_STATS_CALL(this, alloc_handle);
+		SQLAllocHandle(SQL_HANDLE_DBC, p_env->native_env_handle(), &conn_h);
+	}
+
+	// Construct on a specific environment
+	connection::connection(environment & _env)
+		:p_env(&_env),
 		conn_h(NULL),
-		b_connected(false)
+		b_connected(false),
+		conn_serial(0),
+		stmt_cache_size(32),
+		p_queries(NULL)
 	{
-		// Allocate handles
-		__allocate_handle(env_h, conn_h);
+		p_env->acquire();
+
+		// Allocate connection handle
+		TIODBC_STATS_CALL(this, alloc_handle);
+		SQLAllocHandle(SQL_HANDLE_DBC, p_env->native_env_handle(), &conn_h);
 	}
 	
 	// Destructor
@@ -130,10 +424,11 @@ namespace tiodbc
 		disconnect();
 
 		// Close connection handle
+		TIODBC_STATS_CALL(this, free_handle);
 		SQLFreeHandle(SQL_HANDLE_DBC, conn_h);
 
-		// Close enviroment
-		SQLFreeHandle(SQL_HANDLE_ENV, env_h);
+		// Detach from enviroment
+		p_env->release();
 	}
 
 	// open a connection with a data_source
@@ -145,12 +440,16 @@ namespace tiodbc
 		disconnect();
 
 		// Close previous connection handle to be sure
+		TIODBC_STATS_CALL(this, free_handle);
 		SQLFreeHandle(SQL_HANDLE_DBC, conn_h);
+		conn_serial++;
 
 		// Allocate a new connection handle
-		rc = SQLAllocHandle(SQL_HANDLE_DBC, env_h, &conn_h);
+		TIODBC_STATS_CALL(this, alloc_handle);
+		rc = SQLAllocHandle(SQL_HANDLE_DBC, p_env->native_env_handle(), &conn_h);
 
 		// Connect!
+		TIODBC_STATS_CALL(this, connect);
 		rc = SQLConnect(conn_h, 
 			(SQLTCHAR *) _dsn.c_str(),
 			SQL_NTS,
@@ -177,13 +476,99 @@ namespace tiodbc
 	// Close connection
 	void connection::disconnect()
 	{
+		// Close statements still open, they must not outlive the connection
+		std::list<statement *> users;
+		users.swap(m_users);
+		std::list<statement *>::iterator it;
+		for(it = users.begin();it != users.end();it++)
+			(*it)->close();
+
+		// Cached statements are freed with the connection
+		clear_statement_cache();
+		conn_serial++;
+
 		// Disconnect
 		if (connected())
+		{
+			TIODBC_STATS_CALL(this, disconnect);
 			SQLDisconnect(conn_h);
+		}
 
 		b_connected = false;
 	}
 
+	// Set maximum cached statements
+	void connection::set_statement_cache_size(size_t _size)
+	{
+		stmt_cache_size = _size;
+
+		// Drop least recently used
+		while(m_stmt_cache.size() > stmt_cache_size)
+		{
+			TIODBC_STATS_CALL(this, free_handle);
+			SQLFreeHandle(SQL_HANDLE_STMT, m_stmt_cache.back().stmt_h);
+			m_stmt_cache_index.erase(m_stmt_cache.back().sql);
+			m_stmt_cache.pop_back();
+		}
+	}
+
+	// Get maximum cached statements
+	size_t connection::statement_cache_size() const
+	{
+		return stmt_cache_size;
+	}
+
+	// Free all cached statements
+	void connection::clear_statement_cache()
+	{
+		stmt_cache_type::iterator it;
+		for(it = m_stmt_cache.begin();it != m_stmt_cache.end();it++)
+		{
+			TIODBC_STATS_CALL(this, free_handle);
+			SQLFreeHandle(SQL_HANDLE_STMT, it->stmt_h);
+		}
+		m_stmt_cache.clear();
+		m_stmt_cache_index.clear();
+	}
+
+	// Take a prepared statement out of the cache
+	HSTMT connection::take_cached_statement(const _tstring & _sql)
+	{
+		stmt_cache_index_type::iterator it = m_stmt_cache_index.find(_sql);
+		if (it == m_stmt_cache_index.end())
+			return NULL;
+
+		HSTMT stmt = it->second->stmt_h;
+		m_stmt_cache.erase(it->second);
+		m_stmt_cache_index.erase(it);
+		return stmt;
+	}
+
+	// Give back a prepared statement to the cache
+	void connection::return_cached_statement(const _tstring & _sql, HSTMT _stmt, unsigned long _serial)
+	{
+		// Handle died with a previous connection
+		if (_serial != conn_serial)
+			return;
+
+		if (!connected()
+			|| (stmt_cache_size == 0)
+			|| (m_stmt_cache_index.count(_sql) > 0))
+		{
+			TIODBC_STATS_CALL(this, free_handle);
+			SQLFreeHandle(SQL_HANDLE_STMT, _stmt);
+			return;
+		}
+
+		// Add as most recently used
+		cached_statement cached;
+		cached.sql = _sql;
+		cached.stmt_h = _stmt;
+		m_stmt_cache.push_front(cached);
+		m_stmt_cache_index[_sql] = m_stmt_cache.begin();
+		set_statement_cache_size(stmt_cache_size);
+	}
+
 	// Get last error description
 	_tstring connection::last_error()
 	{
@@ -205,403 +590,4752 @@ namespace tiodbc
 		return state;
 	}
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// FIELD IMPLEMENTATION
-	///////////////////////////////////////////////////////////////////////////////////
-
-	//! @cond INTERNAL_FUNCTIONS
-
-	template<class T>
-	T __get_data(HSTMT _stmt, int _col, SQLSMALLINT _ttype, T error_value)
+	// Turn automatic commit on or off
+	bool connection::set_autocommit(bool _enabled)
 	{
-		T tmp_storage;
-		SQLINTEGER cb_needed;
-		RETCODE rc;
-		rc = SQLGetData(_stmt, _col, _ttype, &tmp_storage, sizeof(tmp_storage), &cb_needed);
-		if (!TIODBC_SUCCESS_CODE(rc))
-			return error_value;
-		return tmp_storage;
+		TIODBC_STATS_CALL(this, connect_attr);
+		RETCODE rc = SQLSetConnectAttr(conn_h, SQL_ATTR_AUTOCOMMIT,
+			(SQLPOINTER)(SQLULEN)(_enabled?SQL_AUTOCOMMIT_ON:SQL_AUTOCOMMIT_OFF), SQL_IS_UINTEGER);
+		return TIODBC_SUCCESS_CODE(rc);
 	}
 
-	//! @endcond
-
-	// Not direct contructable
-	field_impl::field_impl(HSTMT _stmt, int _col_num)
-		:stmt_h(_stmt),
-		col_num(_col_num)
-	{}
-
-	//! Destructor
-	field_impl::~field_impl()
-	{}
-
-	// Copy constructor
-	field_impl::field_impl(const field_impl & r)
-		:stmt_h(r.stmt_h),
-		col_num(r.col_num)
+	// Check if connection is in autocommit mode
+	bool connection::autocommit()
 	{
+		SQLUINTEGER value = SQL_AUTOCOMMIT_ON;
+		TIODBC_STATS_CALL(this, connect_attr);
+		RETCODE rc = SQLGetConnectAttr(conn_h, SQL_ATTR_AUTOCOMMIT, &value, SQL_IS_UINTEGER, NULL);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return true;
+		return value != SQL_AUTOCOMMIT_OFF;
 	}
 
-	// Copy operator
-	field_impl & field_impl::operator=(const field_impl & r)
+	// Commit the current transaction
+	bool connection::commit()
 	{
-		stmt_h = r.stmt_h;
-		col_num = r.col_num;
-		return *this;
+		TIODBC_STATS_CALL(this, end_tran);
+		RETCODE rc = SQLEndTran(SQL_HANDLE_DBC, conn_h, SQL_COMMIT);
+		return TIODBC_SUCCESS_CODE(rc);
 	}
 
-	// Get field as string
-	_tstring field_impl::as_string() const
+	// Roll back the current transaction
+	bool connection::rollback()
 	{
-		SQLINTEGER sz_needed = 0;
-		TCHAR small_buff[256];
-		RETCODE rc;
-				
-		// Try with small buffer
-		rc = SQLGetData(stmt_h, col_num, SQL_C_TCHAR, small_buff, sizeof(small_buff), &sz_needed);
-		
-		if (TIODBC_SUCCESS_CODE(rc))
-			return _tstring(small_buff);
-		else if (sz_needed > 0)
-		{	// A bigger buffer is needed
-			SQLINTEGER sz_buff = sz_needed + 1;
-			std::auto_ptr<TCHAR> p_data(new TCHAR[sz_buff]);
-			SQLGetData(stmt_h, col_num, SQL_C_TCHAR, (SQLTCHAR *)p_data.get(), sz_buff, &sz_needed);
-			return _tstring(p_data.get());
-		}
-
-		return _tstring();	// Empty
+		TIODBC_STATS_CALL(this, end_tran);
+		RETCODE rc = SQLEndTran(SQL_HANDLE_DBC, conn_h, SQL_ROLLBACK);
+		return TIODBC_SUCCESS_CODE(rc);
 	}
 
-	// Get field as long
-	long field_impl::as_long() const
+	// Set the isolation level of transactions
+	bool connection::set_isolation_level(SQLUINTEGER _level)
 	{
-		return __get_data<long>(stmt_h, col_num, SQL_C_SLONG, 0);
+		TIODBC_STATS_CALL(this, connect_attr);
+		RETCODE rc = SQLSetConnectAttr(conn_h, SQL_ATTR_TXN_ISOLATION,
+			(SQLPOINTER)(SQLULEN)_level, SQL_IS_UINTEGER);
+		return TIODBC_SUCCESS_CODE(rc);
 	}
 
-	// Get field as unsigned long
-	unsigned long field_impl::as_unsigned_long() const
+	// Get the isolation level of transactions
+	SQLUINTEGER connection::isolation_level()
 	{
-		return __get_data<unsigned long>(stmt_h, col_num, SQL_C_ULONG, 0);
+		SQLUINTEGER value = 0;
+		TIODBC_STATS_CALL(this, connect_attr);
+		RETCODE rc = SQLGetConnectAttr(conn_h, SQL_ATTR_TXN_ISOLATION, &value, SQL_IS_UINTEGER, NULL);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return 0;
+		return value;
 	}
 
-	// Get field as double
-	double field_impl::as_double() const
+	// Get a snapshot of the counters
+	odbc_stats connection::stats() const
 	{
-		return __get_data<double>(stmt_h, col_num, SQL_C_DOUBLE, 0);
+		return m_stats;
 	}
 
-	// Get field as float
-	float field_impl::as_float() const
+	// Set the counters to zero
+	void connection::reset_stats()
 	{
-		return __get_data<float>(stmt_h, col_num, SQL_C_FLOAT, 0);
+		m_stats.reset();
 	}
 
-	// Get field as short
-	short field_impl::as_short() const
+#ifdef TIODBC_HAS_CXX11
+	// Report the latencies of statements to a registry
+	void connection::set_query_registry(query_registry * _registry)
 	{
-		return __get_data<short>(stmt_h, col_num, SQL_C_SSHORT, 0);
+		p_queries = _registry;
 	}
 
-	// Get field as unsigned short
-	unsigned short field_impl::as_unsigned_short() const
+	// Get the registry that statements report to
+	query_registry * connection::get_query_registry() const
 	{
-		return __get_data<unsigned short>(stmt_h, col_num, SQL_C_USHORT, 0);
+		return p_queries;
 	}
+#endif
 
 	///////////////////////////////////////////////////////////////////////////////////
-	// PARAM IMPLEMENTATION
+	// DECIMAL IMPLEMENTATION
 	///////////////////////////////////////////////////////////////////////////////////
 
 	//! @cond INTERNAL_FUNCTIONS
-	template <class T>
-	const T & __bind_param(HSTMT _stmt, int _parnum, SQLSMALLINT _ctype, SQLSMALLINT _sqltype, void * dst_buf, const T & _value)
+
+	// Multiply a 128 bit magnitude by a small number and add another, false on overflow
+	bool __mul_add(SQLUBIGINT & _high, SQLUBIGINT & _low, unsigned long _mul, unsigned long _add)
 	{
-		// Save buffer internally
-		memcpy(dst_buf, &_value, sizeof(_value));
+		// On 32 bit limbs so that no product overflows
+		SQLUBIGINT limbs[4] = {_low & 0xffffffffUL, _low >> 32, _high & 0xffffffffUL, _high >> 32};
+		SQLUBIGINT carry = _add;
+		for(int i = 0;i < 4;i++)
+		{
+			SQLUBIGINT v = limbs[i] * _mul + carry;
+			limbs[i] = v & 0xffffffffUL;
+			carry = v >> 32;
+		}
+		if (carry)
+			return false;
+		_low = limbs[0] | (limbs[1] << 32);
+		_high = limbs[2] | (limbs[3] << 32);
+		return true;
+	}
 
-		// Bind on internal buffer		
-		SQLINTEGER StrLenOrInPoint = 0;
-		SQLBindParameter(_stmt,
-			_parnum,
-			SQL_PARAM_INPUT,
-			_ctype,
-			_sqltype,
-			0,
-			0,
-			(SQLPOINTER *)dst_buf,
-			0,
-			&StrLenOrInPoint
-			);
+	// Divide a 128 bit magnitude by a small number, returns the remainder
+	unsigned long __div_mod(SQLUBIGINT & _high, SQLUBIGINT & _low, unsigned long _div)
+	{
+		SQLUBIGINT limbs[4] = {_low & 0xffffffffUL, _low >> 32, _high & 0xffffffffUL, _high >> 32};
+		SQLUBIGINT rem = 0;
+		for(int i = 3;i >= 0;i--)
+		{
+			SQLUBIGINT v = (rem << 32) | limbs[i];
+			limbs[i] = v / _div;
+			rem = v % _div;
+		}
+		_low = limbs[0] | (limbs[1] << 32);
+		_high = limbs[2] | (limbs[3] << 32);
+		return (unsigned long)rem;
+	}
+
+	// Parse "-123.45" text, spaces around it are ignored and up to 38 fractional digits are accepted
+	bool __text_to_decimal(const TCHAR * _text, SQLLEN _chars, decimal & _value)
+	{
+		SQLLEN i = 0;
+		while((i < _chars) && (_text[i] == ' '))
+			i++;
+
+		decimal value;
+		if ((i < _chars) && ((_text[i] == '-') || (_text[i] == '+')))
+			value.negative = (_text[i++] == '-');
+
+		bool has_digits = false, has_point = false;
+		for(;i < _chars;i++)
+		{
+			TCHAR c = _text[i];
+			if ((c >= '0') && (c <= '9'))
+			{
+				if (!__mul_add(value.high, value.low, 10, (unsigned long)(c - '0')))
+					return false;
+				has_digits = true;
+				if (has_point && (++value.scale > 38))
+					return false;
+			}
+			else if ((c == '.') && !has_point)
+				has_point = true;
+			else
+				break;
+		}
+		while((i < _chars) && (_text[i] == ' '))
+			i++;
+		if (!has_digits || (i < _chars))
+			return false;
 
-		return *(T *) dst_buf;
+		if (!value.low && !value.high)
+			value.negative = false;
+		_value = value;
+		return true;
 	}
 
-	//! @endcond
+	// Set a descriptor record to SQL_C_NUMERIC with precision and scale
+	bool __set_numeric_desc(const statement * _owner, HSTMT _stmt, SQLINTEGER _desc_attr,
+		int _rec, int _precision, int _scale, SQLPOINTER _ptr)
+	{
+		SQLHDESC desc = NULL;
+		TIODBC_STATS_CALL(_owner, stmt_attr);
+		RETCODE rc = SQLGetStmtAttr(_stmt, _desc_attr, &desc, 0, NULL);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
 
-	// Constructor
-	param_impl::param_impl(HSTMT _stmt, int _par_num)
-		:stmt_h(_stmt),
-		par_num(_par_num)
-	{}
+		// Every field unbinds the data pointer, so it goes last
+		TIODBC_STATS_CALL(_owner, set_desc_field);
+		if (!TIODBC_SUCCESS_CODE(SQLSetDescField(desc, (SQLSMALLINT)_rec, SQL_DESC_TYPE, (SQLPOINTER)SQL_C_NUMERIC, 0)))
+			return false;
+		TIODBC_STATS_CALL(_owner, set_desc_field);
+		if (!TIODBC_SUCCESS_CODE(SQLSetDescField(desc, (SQLSMALLINT)_rec, SQL_DESC_PRECISION, (SQLPOINTER)(SQLLEN)_precision, 0)))
+			return false;
+		TIODBC_STATS_CALL(_owner, set_desc_field);
+		if (!TIODBC_SUCCESS_CODE(SQLSetDescField(desc, (SQLSMALLINT)_rec, SQL_DESC_SCALE, (SQLPOINTER)(SQLLEN)_scale, 0)))
+			return false;
+		if (!_ptr)
+			return true;
+		TIODBC_STATS_CALL(_owner, set_desc_field);
+		return TIODBC_SUCCESS_CODE(SQLSetDescField(desc, (SQLSMALLINT)_rec, SQL_DESC_DATA_PTR, _ptr, 0));
+	}
 
-	// Copy constructor
-	param_impl::param_impl(const param_impl & r)
-		:stmt_h(r.stmt_h),
-		par_num(r.par_num)
+	// Get the precision and scale that a DECIMAL/NUMERIC column is read with
+	void __numeric_precision_scale(const column_descriptor & _col, int & _precision, int & _scale)
+	{
+		_precision = 38;
+		_scale = 0;
+		if ((_col.size > 0) && (_col.size <= 38))
+			_precision = (int)_col.size;
+		if ((_col.decimal_digits > 0) && (_col.decimal_digits <= _precision))
+			_scale = _col.decimal_digits;
+	}
+
+	//! @endcond
+
+	// Construct a zero
+	decimal::decimal()
+		:low(0),
+		high(0),
+		negative(false),
+		precision(38),
+		scale(0)
 	{}
 
-	// Destructor
-	param_impl::~param_impl()
+	// Construct from an unscaled integer
+	decimal::decimal(SQLBIGINT _unscaled, int _scale, int _precision)
+		:low((_unscaled < 0)?(SQLUBIGINT)0 - (SQLUBIGINT)_unscaled:(SQLUBIGINT)_unscaled),
+		high(0),
+		negative(_unscaled < 0),
+		precision(_precision),
+		scale(_scale)
 	{}
 
-	// Copy operator
-	param_impl & param_impl::operator=(const param_impl & r)
+	// Construct from an ODBC numeric struct
+	decimal::decimal(const SQL_NUMERIC_STRUCT & _num)
+		:low(0),
+		high(0),
+		negative(false),
+		precision(_num.precision),
+		scale(_num.scale)
 	{
-		stmt_h = r.stmt_h;
-		par_num = r.par_num;
-		return *this;
+		// Magnitude is little endian
+		for(int i = 7;i >= 0;i--)
+		{
+			low = (low << 8) | _num.val[i];
+			high = (high << 8) | _num.val[i + 8];
+		}
+		negative = (_num.sign == 0) && (low || high);
 	}
 
-	// Set as string
-	const _tstring & param_impl::set_as_string(const _tstring & _str)
+	// Convert to an ODBC numeric struct
+	SQL_NUMERIC_STRUCT decimal::as_numeric() const
 	{
-		// Save buffer internally
-		_int_string = _str;
-
-		// Bind on internal buffer		
-		_int_SLOIP = SQL_NTS;
-		SQLBindParameter(stmt_h,
-			par_num,
-			SQL_PARAM_INPUT,
-			SQL_C_TCHAR,
-			SQL_CHAR,
-			(SQLUINTEGER)_int_string.size(),
-			0,
-			(SQLPOINTER *)_int_string.c_str(),
-			(SQLINTEGER)_int_string.size()+1,
-			&_int_SLOIP);;
+		SQL_NUMERIC_STRUCT num;
+		num.precision = (SQLCHAR)precision;
+		num.scale = (SQLSCHAR)scale;
+		num.sign = negative?0:1;
+		for(int i = 0;i < 8;i++)
+		{
+			num.val[i] = (SQLCHAR)(low >> (i * 8));
+			num.val[i + 8] = (SQLCHAR)(high >> (i * 8));
+		}
+		return num;
+	}
 
-		return _int_string;
+	// Check if the unscaled value fits in 64 bit integer
+	bool decimal::fits_int64() const
+	{
+		const SQLUBIGINT limit = (SQLUBIGINT)1 << 63;
+		return (high == 0) && (negative?(low <= limit):(low < limit));
 	}
 
-	// Set as string
-	const long & param_impl::set_as_long(const long & _value)
+	// Get the unscaled value as 64 bit integer
+	SQLBIGINT decimal::unscaled_int64() const
 	{
-		return __bind_param(stmt_h, par_num, SQL_C_SLONG, SQL_INTEGER, _int_buffer, _value);
+		return negative?(SQLBIGINT)((SQLUBIGINT)0 - low):(SQLBIGINT)low;
 	}
 
-	// Set parameter as usigned long
-	const unsigned long & param_impl::set_as_unsigned_long(const unsigned long & _value)
+	// Get value as double
+	double decimal::as_double() const
 	{
-		return __bind_param(stmt_h, par_num, SQL_C_ULONG, SQL_INTEGER, _int_buffer, _value);
+		double value = (double)high * 18446744073709551616.0 + (double)low;
+		double power = 1;
+		for(int i = 0;i < ((scale < 0)?-scale:scale);i++)
+			power *= 10;
+		value = (scale < 0)?value * power:value / power;
+		return negative?-value:value;
 	}
 
+	// Get value as text
+	_tstring decimal::as_string() const
+	{
+		// Digits in reverse order, 128 bits have at most 39
+		TCHAR digits[40];
+		int n = 0;
+		SQLUBIGINT h = high, l = low;
+		do
+		{
+			digits[n++] = (TCHAR)('0' + __div_mod(h, l, 10));
+		} while(h || l);
+
+		_tstring text;
+		text.reserve(n + ((scale > 0)?scale:-scale) + 3);
+		if (negative)
+			text += '-';
+
+		// Leading zeros of a fraction that is longer than the digits
+		if (scale >= n)
+		{
+			text += '0';
+			text += '.';
+			text.append(scale - n, '0');
+		}
+		for(int i = n - 1;i >= 0;i--)
+		{
+			text += digits[i];
+			if ((i == scale) && (i > 0))
+				text += '.';
+		}
+		if (scale < 0)
+			text.append(-scale, '0');
+		return text;
+	}
+
+	// Compare exactly
+	bool decimal::operator==(const decimal & r) const
+	{
+		SQLUBIGINT h1 = high, l1 = low, h2 = r.high, l2 = r.low;
+		int s1 = scale, s2 = r.scale;
+
+		// Bring them to the same scale
+		for(;s1 < s2;s1++)
+			if (!__mul_add(h1, l1, 10, 0))
+				return false;
+		for(;s2 < s1;s2++)
+			if (!__mul_add(h2, l2, 10, 0))
+				return false;
+
+		if ((h1 != h2) || (l1 != l2))
+			return false;
+		return (negative == r.negative) || (!h1 && !l1);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// FIELD IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	//! @cond INTERNAL_FUNCTIONS
+
+	template<class T>
+	T __get_data(const statement * _owner, HSTMT _stmt, int _col, SQLSMALLINT _ttype, T error_value)
+	{
+		T tmp_storage;
+		SQLLEN cb_needed;
+		RETCODE rc;
+		if (_owner->b_rowset_bound)
+			return error_value;	// Unbound column of a block cursor
+		TIODBC_STATS_CALL(_owner, get_data);
+		rc = SQLGetData(_stmt, _col, _ttype, &tmp_storage, sizeof(tmp_storage), &cb_needed);
+		if (!TIODBC_SUCCESS_CODE(rc) || (cb_needed == SQL_NULL_DATA))
+			return error_value;
+		TIODBC_STATS_ADD(_owner, bytes_fetched, sizeof(tmp_storage));
+		return tmp_storage;
+	}
+
+	// Convert text to a number
+	double __text_to_double(const TCHAR * _text)
+	{
+	#ifdef _UNICODE
+		return wcstod(_text, NULL);
+	#else
+		return strtod(_text, NULL);
+	#endif
+	}
+
+	// Convert text to an integer, exactly when it is written as one
+	template<class T>
+	T __text_to_integer(const TCHAR * _text)
+	{
+		const TCHAR * p = _text;
+		while((*p == ' ') || (*p == '\t'))
+			p++;
+		bool b_negative = (*p == '-');
+		if ((*p == '-') || (*p == '+'))
+			p++;
+
+		SQLUBIGINT value = 0;
+		bool b_overflow = false;
+		const TCHAR * digits = p;
+		for(;(*p >= '0') && (*p <= '9');p++)
+		{
+			SQLUBIGINT digit = (SQLUBIGINT)(*p - '0');
+			if (value > (~(SQLUBIGINT)0 - digit) / 10)
+				b_overflow = true;
+			value = value * 10 + digit;
+		}
+		while((*p == ' ') || (*p == '\t'))
+			p++;
+
+		// Fractions, exponents and too large numbers are not exact anyway
+		if ((p == digits) || (*p != 0) || b_overflow)
+			return (T)__text_to_double(_text);
+		return b_negative?(T)(0 - value):(T)value;
+	}
+
+	// Get a value of a block cursor buffer as number
+	template<class T>
+	T __cell_as(SQLSMALLINT _c_type, const char * _cell, SQLLEN _ind, T error_value)
+	{
+		if (_ind == SQL_NULL_DATA)
+			return error_value;
+
+		switch(_c_type)
+		{
+		case SQL_C_SBIGINT:
+			return (T)*(const SQLBIGINT *)_cell;
+		case SQL_C_UBIGINT:
+			return (T)*(const SQLUBIGINT *)_cell;
+		case SQL_C_SLONG:
+			return (T)*(const SQLINTEGER *)_cell;
+		case SQL_C_ULONG:
+			return (T)*(const SQLUINTEGER *)_cell;
+		case SQL_C_SSHORT:
+			return (T)*(const SQLSMALLINT *)_cell;
+		case SQL_C_USHORT:
+			return (T)*(const SQLUSMALLINT *)_cell;
+		case SQL_C_BIT:
+			return (T)*(const unsigned char *)_cell;
+		case SQL_C_DOUBLE:
+			return (T)*(const double *)_cell;
+		case SQL_C_FLOAT:
+			return (T)*(const float *)_cell;
+		case SQL_C_TCHAR:
+			if (std::numeric_limits<T>::is_integer)
+				return __text_to_integer<T>((const TCHAR *)_cell);
+			return (T)__text_to_double((const TCHAR *)_cell);
+		case SQL_C_NUMERIC:
+			{
+				decimal value(*(const SQL_NUMERIC_STRUCT *)_cell);
+				if (std::numeric_limits<T>::is_integer && (value.scale == 0) && value.fits_int64())
+					return (T)value.unscaled_int64();
+				return (T)value.as_double();
+			}
+		}
+		return error_value;
+	}
+
+	// Append a number with leading zeros up to the given digits
+	void __append_padded(_tstring & _text, unsigned long _value, int _digits)
+	{
+		TCHAR digits[20];
+		int n = 0;
+		do
+		{
+			digits[n++] = (TCHAR)('0' + _value % 10);
+			_value /= 10;
+		} while(_value);
+		for(;_digits > n;_digits--)
+			_text += '0';
+		while(n > 0)
+			_text += digits[--n];
+	}
+
+	// Append a number as upper case hexadecimal digits
+	void __append_hex(_tstring & _text, unsigned long _value, int _digits)
+	{
+		static const char hex[] = "0123456789ABCDEF";
+		for(int i = _digits - 1;i >= 0;i--)
+			_text += (TCHAR)hex[(_value >> (i * 4)) & 0xF];
+	}
+
+	// Format a timestamp as "yyyy-mm-dd hh:mm:ss.fffffffff", the fraction without trailing zeros
+	_tstring __timestamp_to_text(const SQL_TIMESTAMP_STRUCT & _ts)
+	{
+		_tstring text;
+		text.reserve(29);
+		if (_ts.year < 0)
+			text += '-';
+		__append_padded(text, (_ts.year < 0)?-_ts.year:_ts.year, 4);
+		text += '-';
+		__append_padded(text, _ts.month, 2);
+		text += '-';
+		__append_padded(text, _ts.day, 2);
+		text += ' ';
+		__append_padded(text, _ts.hour, 2);
+		text += ':';
+		__append_padded(text, _ts.minute, 2);
+		text += ':';
+		__append_padded(text, _ts.second, 2);
+		if (_ts.fraction)
+		{
+			text += '.';
+			__append_padded(text, _ts.fraction, 9);
+			text.erase(text.find_last_not_of('0') + 1);
+		}
+		return text;
+	}
+
+	// Format a GUID as "XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"
+	_tstring __guid_to_text(const SQLGUID & _guid)
+	{
+		_tstring text;
+		text.reserve(36);
+		__append_hex(text, _guid.Data1, 8);
+		text += '-';
+		__append_hex(text, _guid.Data2, 4);
+		text += '-';
+		__append_hex(text, _guid.Data3, 4);
+		text += '-';
+		for(int i = 0;i < 8;i++)
+		{
+			if (i == 2)
+				text += '-';
+			__append_hex(text, _guid.Data4[i], 2);
+		}
+		return text;
+	}
+
+	// Get a value of a block cursor buffer as string
+	_tstring __cell_as_string(SQLSMALLINT _c_type, const char * _cell, SQLLEN _ind, SQLLEN _width)
+	{
+		if (_ind == SQL_NULL_DATA)
+			return _tstring();
+
+		if (_c_type == SQL_C_TCHAR)
+		{
+			SQLLEN max_chars = _width / sizeof(TCHAR) - 1;
+			SQLLEN chars = ((_ind < 0) || (_ind / (SQLLEN)sizeof(TCHAR) > max_chars))?max_chars:_ind / sizeof(TCHAR);
+			return _tstring((const TCHAR *)_cell, chars);
+		}
+
+		switch(_c_type)
+		{
+		case SQL_C_NUMERIC:
+			return decimal(*(const SQL_NUMERIC_STRUCT *)_cell).as_string();
+		case SQL_C_TYPE_TIMESTAMP:
+			return __timestamp_to_text(*(const SQL_TIMESTAMP_STRUCT *)_cell);
+		case SQL_C_GUID:
+			return __guid_to_text(*(const SQLGUID *)_cell);
+		case SQL_C_BINARY:
+			{	// Hexadecimal digits, as drivers convert binaries to text
+				SQLLEN length = ((_ind < 0) || (_ind > _width))?_width:_ind;
+				_tstring text;
+				text.reserve(length * 2);
+				for(SQLLEN i = 0;i < length;i++)
+					__append_hex(text, (unsigned char)_cell[i], 2);
+				return text;
+			}
+		}
+
+		std::basic_ostringstream<TCHAR> out;
+		if (_c_type == SQL_C_DOUBLE)
+		{
+			out.precision(std::numeric_limits<double>::digits10);
+			out << *(const double *)_cell;
+		}
+		else if (_c_type == SQL_C_FLOAT)
+		{
+			out.precision(std::numeric_limits<float>::digits10);
+			out << *(const float *)_cell;
+		}
+		else if (_c_type == SQL_C_UBIGINT)
+			out << *(const SQLUBIGINT *)_cell;
+		else
+			out << __cell_as<SQLBIGINT>(_c_type, _cell, _ind, 0);
+		return out.str();
+	}
+
+	// Get a text cell of a block cursor buffer and its length in characters
+	const TCHAR * __cell_text(SQLSMALLINT _c_type, const char * _cell, SQLLEN _ind, SQLLEN _width, SQLLEN & _chars)
+	{
+		if ((_c_type != SQL_C_TCHAR) || (_ind == SQL_NULL_DATA))
+			return NULL;
+		SQLLEN max_chars = _width / sizeof(TCHAR) - 1;
+		_chars = ((_ind < 0) || (_ind / (SQLLEN)sizeof(TCHAR) > max_chars))?max_chars:_ind / sizeof(TCHAR);
+		return (const TCHAR *)_cell;
+	}
+
+	// Get the value of a hexadecimal digit, -1 if it is not one
+	inline int __hex_digit(TCHAR _c)
+	{
+		if ((_c >= '0') && (_c <= '9'))
+			return _c - '0';
+		if ((_c >= 'a') && (_c <= 'f'))
+			return _c - 'a' + 10;
+		if ((_c >= 'A') && (_c <= 'F'))
+			return _c - 'A' + 10;
+		return -1;
+	}
+
+	// Parse "yyyy-mm-dd hh:mm:ss.fffffffff" text, any part after the date may be missing
+	bool __text_to_timestamp(const TCHAR * _text, SQLLEN _chars, SQL_TIMESTAMP_STRUCT & _ts)
+	{
+		unsigned long parts[7] = {0, 0, 0, 0, 0, 0, 0};
+		int fraction_digits = 0;
+		int part = 0;
+		bool in_number = false;
+		for(SQLLEN i = 0;(i < _chars) && (part < 7);i++)
+		{
+			TCHAR c = _text[i];
+			if ((c >= '0') && (c <= '9'))
+			{
+				if (part == 6)
+				{	// Only nanoseconds are kept
+					if (fraction_digits == 9)
+						continue;
+					fraction_digits++;
+				}
+				parts[part] = parts[part] * 10 + (c - '0');
+				in_number = true;
+			}
+			else if (in_number)
+			{
+				part++;
+				in_number = false;
+			}
+		}
+		if ((part < 2) || ((part == 2) && !in_number))
+			return false;
+
+		for(;fraction_digits < 9;fraction_digits++)
+			parts[6] *= 10;
+		_ts.year = (SQLSMALLINT)parts[0];
+		_ts.month = (SQLUSMALLINT)parts[1];
+		_ts.day = (SQLUSMALLINT)parts[2];
+		_ts.hour = (SQLUSMALLINT)parts[3];
+		_ts.minute = (SQLUSMALLINT)parts[4];
+		_ts.second = (SQLUSMALLINT)parts[5];
+		_ts.fraction = (SQLUINTEGER)parts[6];
+		return true;
+	}
+
+	// Parse "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" text, braces are ignored
+	bool __text_to_guid(const TCHAR * _text, SQLLEN _chars, SQLGUID & _guid)
+	{
+		unsigned char bytes[16];
+		int nibbles = 0;
+		for(SQLLEN i = 0;i < _chars;i++)
+		{
+			int v = __hex_digit(_text[i]);
+			if (v < 0)
+				continue;
+			if (nibbles == 32)
+				return false;
+			if (nibbles % 2)
+				bytes[nibbles / 2] = (unsigned char)(bytes[nibbles / 2] * 16 + v);
+			else
+				bytes[nibbles / 2] = (unsigned char)v;
+			nibbles++;
+		}
+		if (nibbles != 32)
+			return false;
+
+		// The first three groups are numbers, the last one raw bytes
+		_guid.Data1 = ((DWORD)bytes[0] << 24) | ((DWORD)bytes[1] << 16) | ((DWORD)bytes[2] << 8) | bytes[3];
+		_guid.Data2 = (WORD)((bytes[4] << 8) | bytes[5]);
+		_guid.Data3 = (WORD)((bytes[6] << 8) | bytes[7]);
+		memcpy(_guid.Data4, bytes + 8, 8);
+		return true;
+	}
+
+	//! @endcond
+
+	// Not direct contructable
+	field_impl::field_impl(const statement * _stmt, int _col_num)
+		:p_stmt(_stmt),
+		stmt_h(_stmt->stmt_h),
+		col_num(_col_num)
+	{}
+
+	//! Destructor
+	field_impl::~field_impl()
+	{}
+
+	// Copy constructor
+	field_impl::field_impl(const field_impl & r)
+		:p_stmt(r.p_stmt),
+		stmt_h(r.stmt_h),
+		col_num(r.col_num)
+	{
+	}
+
+	// Copy operator
+	field_impl & field_impl::operator=(const field_impl & r)
+	{
+		p_stmt = r.p_stmt;
+		stmt_h = r.stmt_h;
+		col_num = r.col_num;
+		return *this;
+	}
+
+	// Get the bound buffer of this field in the current rowset
+	const char * field_impl::bound_cell(SQLSMALLINT & _c_type, SQLLEN & _ind) const
+	{
+		if (!p_stmt->b_rowset_bound
+			|| (col_num < 1)
+			|| (col_num > (int)p_stmt->m_bound_columns.size())
+			|| (p_stmt->rowset_pos >= p_stmt->rows_fetched))
+			return NULL;
+
+		const statement::bound_column & col = p_stmt->m_bound_columns[col_num - 1];
+		_c_type = col.c_type;
+		_ind = col.p_indicators[p_stmt->rowset_pos];
+		return col.p_values + p_stmt->rowset_pos * col.width;
+	}
+
+	// Get field as string
+	_tstring field_impl::as_string() const
+	{
+		return as_string_view().str();
+	}
+
+	// Get field as a view of a string owned by the statement
+	tstring_view field_impl::as_string_view() const
+	{
+		SQLLEN ind;
+		RETCODE rc;
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+
+		if (col_num < 1)
+			return tstring_view();
+		if ((int)p_stmt->m_text_buffers.size() < col_num)
+		{
+			statement::text_buffer empty;
+			empty.length = 0;
+			empty.serial = 0;
+			p_stmt->m_text_buffers.resize(col_num, empty);
+		}
+
+		// Already read for this row
+		statement::text_buffer & text = p_stmt->m_text_buffers[col_num - 1];
+		if (text.serial == p_stmt->fetch_serial)
+			return tstring_view(text.length?&text.data[0]:NULL, text.length);
+		text.serial = p_stmt->fetch_serial;
+		text.length = 0;
+
+		// Served from rowset
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+		{
+			if (ind == SQL_NULL_DATA)
+				return tstring_view();
+
+			SQLLEN width = p_stmt->m_bound_columns[col_num - 1].width;
+			if (c_type == SQL_C_TCHAR)
+			{	// View it in place
+				SQLLEN max_chars = width / sizeof(TCHAR) - 1;
+				SQLLEN chars = ((ind < 0) || (ind / (SQLLEN)sizeof(TCHAR) > max_chars))?max_chars:ind / sizeof(TCHAR);
+				return tstring_view((const TCHAR *)cell, chars);
+			}
+
+			_tstring value = __cell_as_string(c_type, cell, ind, width);
+			text.data.assign(value.begin(), value.end());
+			text.length = value.size();
+			return tstring_view(text.length?&text.data[0]:NULL, text.length);
+		}
+
+		// Columns left unbound by a block cursor can not be read
+		if (p_stmt->b_rowset_bound)
+			return tstring_view();
+
+		// Read it in chunks, growing the buffer as needed
+		if (text.data.size() < 256)
+			text.data.resize(256);
+		while(true)
+		{
+			SQLLEN room = (SQLLEN)(text.data.size() - text.length - 1);
+			TIODBC_STATS_CALL(p_stmt, get_data);
+			rc = SQLGetData(stmt_h, col_num, SQL_C_TCHAR, &text.data[text.length],
+				(room + 1) * sizeof(TCHAR), &ind);
+			if (!TIODBC_SUCCESS_CODE(rc) || (ind == SQL_NULL_DATA))
+				break;
+
+			SQLLEN remaining = (ind == SQL_NO_TOTAL)?-1:ind / (SQLLEN)sizeof(TCHAR);
+			if ((rc == SQL_SUCCESS) || ((remaining >= 0) && (remaining <= room)))
+			{	// Last chunk
+				text.length += (remaining >= 0 && remaining <= room)?remaining:room;
+				break;
+			}
+
+			// Truncated
+			text.length += room;
+			size_t needed = (remaining < 0)?0:text.length + (remaining - room) + 1;
+			text.data.resize((needed > text.data.size() * 2)?needed:text.data.size() * 2);
+		}
+		TIODBC_STATS_ADD(p_stmt, bytes_fetched, text.length * sizeof(TCHAR));
+		return tstring_view(text.length?&text.data[0]:NULL, text.length);
+	}
+
+	// Read the field in chunks and pass them to a sink
+	bool field_impl::read_stream(data_sink & _sink, bool _binary, size_t _chunk_size) const
+	{
+		SQLLEN ind;
+		RETCODE rc;
+		SQLSMALLINT c_type;
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+
+		// Served from rowset
+		const char * cell = bound_cell(c_type, ind);
+		if (cell && _binary)
+		{
+			if (c_type != SQL_C_BINARY)
+				return false;
+			SQLLEN width = p_stmt->m_bound_columns[col_num - 1].width;
+			SQLLEN length = (ind == SQL_NULL_DATA)?0:((ind < 0) || (ind > width))?width:ind;
+			return !length || _sink.write(cell, (size_t)length);
+		}
+		if (cell)
+		{
+			tstring_view text = as_string_view();
+			return text.empty() || _sink.write((const char *)text.data(), text.size() * sizeof(TCHAR));
+		}
+
+		if (p_stmt->b_rowset_bound)
+			return false;	// Unbound column of a block cursor
+
+		// Room for the null character of text and at least one character
+		size_t terminator = _binary?0:sizeof(TCHAR);
+		if (_chunk_size < terminator * 2 + 1)
+			_chunk_size = terminator * 2 + 1;
+		std::vector<char> & buf = p_stmt->m_stream_buffer;
+		if (buf.size() < _chunk_size)
+			buf.resize(_chunk_size);
+
+		SQLLEN room = (SQLLEN)(((_chunk_size - terminator) / sizeof(TCHAR)) * sizeof(TCHAR));
+		if (_binary)
+			room = (SQLLEN)_chunk_size;
+		while(true)
+		{
+			TIODBC_STATS_CALL(p_stmt, get_data);
+			rc = SQLGetData(stmt_h, col_num, _binary?SQL_C_BINARY:SQL_C_TCHAR,
+				&buf[0], room + terminator, &ind);
+			if (rc == SQL_NO_DATA)
+				return true;
+			if (!TIODBC_SUCCESS_CODE(rc))
+				return false;
+			if (ind == SQL_NULL_DATA)
+				return true;
+
+			SQLLEN got = ((ind == SQL_NO_TOTAL) || (ind > room))?room:ind;
+			TIODBC_STATS_ADD(p_stmt, bytes_fetched, got);
+			if ((got > 0) && !_sink.write(&buf[0], (size_t)got))
+				return false;
+			if ((rc == SQL_SUCCESS) || ((ind != SQL_NO_TOTAL) && (ind <= room)))
+				return true;
+		}
+	}
+
+	// Get field as long
+	long field_impl::as_long() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<long>(c_type, cell, ind, 0);
+		return __get_data<SQLINTEGER>(p_stmt, stmt_h, col_num, SQL_C_SLONG, 0);
+	}
+
+	// Get field as unsigned long
+	unsigned long field_impl::as_unsigned_long() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<unsigned long>(c_type, cell, ind, 0);
+		return __get_data<SQLUINTEGER>(p_stmt, stmt_h, col_num, SQL_C_ULONG, 0);
+	}
+
+	// Get field as double
+	double field_impl::as_double() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<double>(c_type, cell, ind, 0);
+		return __get_data<double>(p_stmt, stmt_h, col_num, SQL_C_DOUBLE, 0);
+	}
+
+	// Get field as float
+	float field_impl::as_float() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<float>(c_type, cell, ind, 0);
+		return __get_data<float>(p_stmt, stmt_h, col_num, SQL_C_FLOAT, 0);
+	}
+
+	// Get field as short
+	short field_impl::as_short() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<short>(c_type, cell, ind, 0);
+		return __get_data<short>(p_stmt, stmt_h, col_num, SQL_C_SSHORT, 0);
+	}
+
+	// Get field as unsigned short
+	unsigned short field_impl::as_unsigned_short() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<unsigned short>(c_type, cell, ind, 0);
+		return __get_data<unsigned short>(p_stmt, stmt_h, col_num, SQL_C_USHORT, 0);
+	}
+
+	// Get field as 64 bit integer
+	SQLBIGINT field_impl::as_int64() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<SQLBIGINT>(c_type, cell, ind, 0);
+		return __get_data<SQLBIGINT>(p_stmt, stmt_h, col_num, SQL_C_SBIGINT, 0);
+	}
+
+	// Get field as unsigned 64 bit integer
+	SQLUBIGINT field_impl::as_uint64() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+			return __cell_as<SQLUBIGINT>(c_type, cell, ind, 0);
+		return __get_data<SQLUBIGINT>(p_stmt, stmt_h, col_num, SQL_C_UBIGINT, 0);
+	}
+
+	// Get field as raw bytes
+	SQLLEN field_impl::as_binary(void * _buffer, size_t _size) const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell && (c_type == SQL_C_BINARY))
+		{
+			if (ind == SQL_NULL_DATA)
+				return SQL_NULL_DATA;
+			SQLLEN width = p_stmt->m_bound_columns[col_num - 1].width;
+			SQLLEN length = ((ind < 0) || (ind > width))?width:ind;
+			memcpy(_buffer, cell, ((size_t)length < _size)?(size_t)length:_size);
+			return length;
+		}
+		if (cell)
+		{	// Decode the hexadecimal text of a character column
+			SQLLEN chars;
+			const TCHAR * text = __cell_text(c_type, cell, ind,
+				p_stmt->m_bound_columns[col_num - 1].width, chars);
+			if (!text)
+				return SQL_NULL_DATA;
+
+			SQLLEN length = chars / 2;
+			unsigned char * out = (unsigned char *)_buffer;
+			for(SQLLEN i = 0;(i < length) && ((size_t)i < _size);i++)
+			{
+				int hi = __hex_digit(text[i * 2]);
+				int lo = __hex_digit(text[i * 2 + 1]);
+				if ((hi < 0) || (lo < 0))
+					return SQL_NULL_DATA;
+				out[i] = (unsigned char)(hi * 16 + lo);
+			}
+			return length;
+		}
+
+		if (p_stmt->b_rowset_bound)
+			return SQL_NULL_DATA;	// Unbound column of a block cursor
+
+		TIODBC_STATS_CALL(p_stmt, get_data);
+		RETCODE rc = SQLGetData(stmt_h, col_num, SQL_C_BINARY, _buffer, (SQLLEN)_size, &ind);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return SQL_NULL_DATA;
+		if (ind > 0)
+			TIODBC_STATS_ADD(p_stmt, bytes_fetched, ((size_t)ind > _size)?_size:(size_t)ind);
+		return ind;
+	}
+
+	// Get field as GUID
+	SQLGUID field_impl::as_guid() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQLGUID value;
+		memset(&value, 0, sizeof(value));
+
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+		{
+			if ((c_type == SQL_C_GUID) && (ind != SQL_NULL_DATA))
+				memcpy(&value, cell, sizeof(value));
+
+			SQLLEN chars;
+			const TCHAR * text = __cell_text(c_type, cell, ind,
+				p_stmt->m_bound_columns[col_num - 1].width, chars);
+			if (text && !__text_to_guid(text, chars, value))
+				memset(&value, 0, sizeof(value));
+			return value;
+		}
+		return __get_data<SQLGUID>(p_stmt, stmt_h, col_num, SQL_C_GUID, value);
+	}
+
+	// Get field as exact decimal
+	decimal field_impl::as_decimal() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		decimal value;
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+		{
+			if (ind == SQL_NULL_DATA)
+				return value;
+			if (c_type == SQL_C_NUMERIC)
+				return decimal(*(const SQL_NUMERIC_STRUCT *)cell);
+
+			SQLLEN chars;
+			SQLLEN width = p_stmt->m_bound_columns[col_num - 1].width;
+			const TCHAR * text = __cell_text(c_type, cell, ind, width, chars);
+			if (text)
+			{
+				if (!__text_to_decimal(text, chars, value))
+					return decimal();
+			}
+			else if (c_type == SQL_C_SBIGINT)
+				value = decimal(*(const SQLBIGINT *)cell);
+			else if (c_type == SQL_C_UBIGINT)
+				value.low = *(const SQLUBIGINT *)cell;	// Magnitude of the unsigned value
+			else
+			{	// Floating point, as exact as its text is
+				_tstring str = __cell_as_string(c_type, cell, ind, width);
+				if (!__text_to_decimal(str.c_str(), (SQLLEN)str.size(), value))
+					return decimal();
+			}
+			return value;
+		}
+
+		// Precision and scale of the column
+		int precision = 38, scale = 0;
+		if (p_stmt->describe() && (col_num >= 1) && (col_num <= (int)p_stmt->m_columns.size()))
+			__numeric_precision_scale(p_stmt->m_columns[col_num - 1], precision, scale);
+
+		// Set the row descriptor once per result set
+		std::vector<char> & numeric_ard = p_stmt->m_numeric_ard;
+		if ((col_num < 1) || p_stmt->b_rowset_bound)
+			return value;
+		if ((int)numeric_ard.size() < col_num)
+			numeric_ard.resize(col_num, 0);
+		if (!numeric_ard[col_num - 1])
+		{
+			if (!__set_numeric_desc(p_stmt, stmt_h, SQL_ATTR_APP_ROW_DESC, col_num, precision, scale, NULL))
+				return value;
+			numeric_ard[col_num - 1] = 1;
+		}
+
+		SQL_NUMERIC_STRUCT num;
+		TIODBC_STATS_CALL(p_stmt, get_data);
+		RETCODE rc = SQLGetData(stmt_h, col_num, SQL_ARD_TYPE, &num, sizeof(num), &ind);
+		if (!TIODBC_SUCCESS_CODE(rc) || (ind == SQL_NULL_DATA))
+			return value;
+		TIODBC_STATS_ADD(p_stmt, bytes_fetched, sizeof(num));
+		return decimal(num);
+	}
+
+	// Get field as timestamp
+	SQL_TIMESTAMP_STRUCT field_impl::as_timestamp() const
+	{
+		TIODBC_STATS_TIMER(p_stmt, convert_ns);
+		SQL_TIMESTAMP_STRUCT value;
+		memset(&value, 0, sizeof(value));
+
+		SQLSMALLINT c_type;
+		SQLLEN ind;
+		const char * cell = bound_cell(c_type, ind);
+		if (cell)
+		{
+			if ((c_type == SQL_C_TYPE_TIMESTAMP) && (ind != SQL_NULL_DATA))
+				memcpy(&value, cell, sizeof(value));
+
+			SQLLEN chars;
+			const TCHAR * text = __cell_text(c_type, cell, ind,
+				p_stmt->m_bound_columns[col_num - 1].width, chars);
+			if (text && !__text_to_timestamp(text, chars, value))
+				memset(&value, 0, sizeof(value));
+			return value;
+		}
+		return __get_data<SQL_TIMESTAMP_STRUCT>(p_stmt, stmt_h, col_num, SQL_C_TYPE_TIMESTAMP, value);
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Get field as a point of system clock
+	std::chrono::system_clock::time_point field_impl::as_time_point() const
+	{
+		SQL_TIMESTAMP_STRUCT ts = as_timestamp();
+		if (ts.month == 0)
+			return std::chrono::system_clock::time_point();
+
+		// Days since epoch of the civil date (proleptic Gregorian calendar)
+		long long y = ts.year - ((ts.month <= 2)?1:0);
+		long long era = ((y >= 0)?y:y - 399) / 400;
+		long long yoe = y - era * 400;
+		long long doy = (153 * (ts.month + ((ts.month > 2)?-3:9)) + 2) / 5 + ts.day - 1;
+		long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		long long days = era * 146097 + doe - 719468;
+
+		std::chrono::nanoseconds since_epoch = std::chrono::seconds(days * 86400
+			+ ts.hour * 3600 + ts.minute * 60 + ts.second)
+			+ std::chrono::nanoseconds(ts.fraction);
+		return std::chrono::system_clock::time_point(
+			std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch));
+	}
+#endif
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// DATA SINK/SOURCE IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Construct a sink writing to a stream
+	ostream_sink::ostream_sink(std::ostream & _out)
+		:out(_out)
+	{
+	}
+
+	// Write the chunk to the stream
+	bool ostream_sink::write(const char * _data, size_t _size)
+	{
+		out.write(_data, (std::streamsize)_size);
+		return out.good();
+	}
+
+	// Construct a source reading from a stream
+	istream_source::istream_source(std::istream & _in)
+		:in(_in)
+	{
+	}
+
+	// Read the next chunk from the stream
+	bool istream_source::read(char * _buffer, size_t _size, size_t & _read)
+	{
+		in.read(_buffer, (std::streamsize)_size);
+		_read = (size_t)in.gcount();
+		return !in.bad();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// PARAM IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	//! @cond INTERNAL_FUNCTIONS
+	// Bind a column-wise array of fixed size values
+	template <class TNative, class T>
+	bool __bind_param_array(const statement * _owner, HSTMT _stmt, int _parnum, SQLSMALLINT _ctype, SQLSMALLINT _sqltype,
+		std::vector<char> & _buffer, const std::vector<T> & _values)
+	{
+		// Save values internally in their native size
+		_buffer.resize(sizeof(TNative) * (_values.empty()?1:_values.size()));
+		TNative * p_dst = (TNative *)&_buffer[0];
+		for(size_t i = 0;i < _values.size();i++)
+			p_dst[i] = (TNative)_values[i];
+
+		TIODBC_STATS_CALL(_owner, bind_parameter);
+		RETCODE rc = SQLBindParameter(_stmt,
+			_parnum,
+			SQL_PARAM_INPUT,
+			_ctype,
+			_sqltype,
+			0,
+			0,
+			(SQLPOINTER)p_dst,
+			sizeof(TNative),
+			NULL);
+		return TIODBC_SUCCESS_CODE(rc);
+	}
+
+	//! @endcond
+
+	// Constructor
+	param_impl::param_impl(statement * _stmt, int _par_num)
+		:p_stmt(_stmt),
+		stmt_h(_stmt->stmt_h),
+		par_num(_par_num),
+		_int_array_rows(0),
+		p_source(NULL),
+		b_bound(false)
+	{}
+
+	// Copy constructor
+	param_impl::param_impl(const param_impl & r)
+		:p_stmt(r.p_stmt),
+		stmt_h(r.stmt_h),
+		par_num(r.par_num),
+		_int_array_rows(0),
+		p_source(NULL),
+		b_bound(false)
+	{}
+
+	// Destructor
+	param_impl::~param_impl()
+	{}
+
+	// Copy operator
+	param_impl & param_impl::operator=(const param_impl & r)
+	{
+		p_stmt = r.p_stmt;
+		stmt_h = r.stmt_h;
+		par_num = r.par_num;
+		_int_array_rows = 0;
+		p_source = NULL;
+		b_bound = false;
+		return *this;
+	}
+
+	// Bind the parameter unless it is already bound the same way
+	bool param_impl::bind(SQLSMALLINT _c_type, SQLSMALLINT _sql_type, SQLULEN _column_size,
+		SQLSMALLINT _digits, SQLPOINTER _ptr, SQLLEN _length)
+	{
+		if (b_bound
+			&& (bound_c_type == _c_type)
+			&& (bound_sql_type == _sql_type)
+			&& (bound_column_size == _column_size)
+			&& (bound_digits == _digits)
+			&& (bound_ptr == _ptr)
+			&& (bound_length == _length))
+			return true;
+
+		p_stmt->stop_prefetch();
+		TIODBC_STATS_CALL(p_stmt, bind_parameter);
+		RETCODE rc = SQLBindParameter(stmt_h,
+			par_num,
+			SQL_PARAM_INPUT,
+			_c_type,
+			_sql_type,
+			_column_size,
+			_digits,
+			_ptr,
+			_length,
+			&_int_SLOIP);
+		b_bound = TIODBC_SUCCESS_CODE(rc);
+
+		p_stmt->release_param_slot(par_num);
+
+		// Precision and scale of numeric values are taken from the descriptor
+		if (b_bound && (_c_type == SQL_C_NUMERIC))
+			b_bound = __set_numeric_desc(p_stmt, stmt_h, SQL_ATTR_APP_PARAM_DESC, par_num,
+				(int)_column_size, _digits, _ptr);
+		bound_c_type = _c_type;
+		bound_sql_type = _sql_type;
+		bound_column_size = _column_size;
+		bound_digits = _digits;
+		bound_ptr = _ptr;
+		bound_length = _length;
+		return b_bound;
+	}
+
+	// Store a fixed size value in internal buffer and bind it
+	template<class T>
+	const T & param_impl::set_value(const T & _value, SQLSMALLINT _c_type, SQLSMALLINT _sql_type)
+	{
+		_int_array_rows = 0;
+		memcpy(_int_buffer, &_value, sizeof(T));
+		_int_SLOIP = sizeof(T);
+		bind(_c_type, _sql_type, 0, 0, _int_buffer, sizeof(T));
+		return *(const T *)_int_buffer;
+	}
+
+	// Set as string
+	const _tstring & param_impl::set_as_string(const _tstring & _str)
+	{
+		// Save buffer internally, its capacity does not shrink
+		// so it is bound again only when it grows
+		_int_string = _str;
+		_int_array_rows = 0;
+
+		_int_SLOIP = (SQLLEN)(_int_string.size() * sizeof(TCHAR));
+		size_t capacity = _int_string.capacity();
+		bind(SQL_C_TCHAR,
+			SQL_VARCHAR,
+			(SQLULEN)(capacity?capacity:1),
+			0,
+			(SQLPOINTER)_int_string.c_str(),
+			(SQLLEN)((capacity + 1) * sizeof(TCHAR)));
+
+		return _int_string;
+	}
+
+	// Set as a string buffer of the caller
+	bool param_impl::set_as_external_string(const TCHAR * _data, size_t _chars, size_t _capacity)
+	{
+		_int_array_rows = 0;
+		if (_capacity < _chars)
+			_capacity = _chars;
+
+		_int_SLOIP = (SQLLEN)(_chars * sizeof(TCHAR));
+		return bind(SQL_C_TCHAR,
+			SQL_VARCHAR,
+			(SQLULEN)(_capacity?_capacity:1),
+			0,
+			(SQLPOINTER)_data,
+			(SQLLEN)(_capacity * sizeof(TCHAR)));
+	}
+
+	// Set as long
+	const long & param_impl::set_as_long(const long & _value)
+	{
+		return set_value(_value, (sizeof(long) > sizeof(SQLINTEGER))?SQL_C_SBIGINT:SQL_C_SLONG, SQL_INTEGER);
+	}
+
+	// Set parameter as usigned long
+	const unsigned long & param_impl::set_as_unsigned_long(const unsigned long & _value)
+	{
+		return set_value(_value, (sizeof(unsigned long) > sizeof(SQLUINTEGER))?SQL_C_UBIGINT:SQL_C_ULONG, SQL_INTEGER);
+	}
+
+	// Set parameter as 64 bit integer
+	const SQLBIGINT & param_impl::set_as_int64(const SQLBIGINT & _value)
+	{
+		return set_value(_value, SQL_C_SBIGINT, SQL_BIGINT);
+	}
+
+	// Set parameter as unsigned 64 bit integer
+	const SQLUBIGINT & param_impl::set_as_uint64(const SQLUBIGINT & _value)
+	{
+		return set_value(_value, SQL_C_UBIGINT, SQL_BIGINT);
+	}
+
+	// Set parameter as double
+	const double & param_impl::set_as_double(const double & _value)
+	{
+		return set_value(_value, SQL_C_DOUBLE, SQL_DOUBLE);
+	}
+
+	// Set parameter as float
+	const float & param_impl::set_as_float(const float & _value)
+	{
+		return set_value(_value, SQL_C_FLOAT, SQL_REAL);
+	}
+
+	// Set parameter as raw bytes
+	bool param_impl::set_as_binary(const void * _data, size_t _size)
+	{
+		// The array buffer does not shrink, so it is bound again only when it grows
+		_int_array_rows = 0;
+		if (_int_array.size() < _size)
+			_int_array.resize((_size > _int_array.size() * 2)?_size:(_int_array.size() * 2));
+		if (_int_array.empty())
+			_int_array.resize(1);
+		if (_size)
+			memcpy(&_int_array[0], _data, _size);
+
+		_int_SLOIP = (SQLLEN)_size;
+		size_t capacity = _int_array.size();
+		return bind(SQL_C_BINARY,
+			SQL_VARBINARY,
+			(SQLULEN)capacity,
+			0,
+			(SQLPOINTER)&_int_array[0],
+			(SQLLEN)capacity);
+	}
+
+	// Set parameter as timestamp
+	const SQL_TIMESTAMP_STRUCT & param_impl::set_as_timestamp(const SQL_TIMESTAMP_STRUCT & _value, int _fraction_digits)
+	{
+		if (_fraction_digits < 0)
+			_fraction_digits = 0;
+		if (_fraction_digits > 9)
+			_fraction_digits = 9;
+
+		_int_array_rows = 0;
+		memcpy(_int_buffer, &_value, sizeof(_value));
+		_int_SLOIP = sizeof(_value);
+
+		// "yyyy-mm-dd hh:mm:ss" plus "." and the fraction digits
+		bind(SQL_C_TYPE_TIMESTAMP,
+			SQL_TYPE_TIMESTAMP,
+			(SQLULEN)(_fraction_digits?(20 + _fraction_digits):19),
+			(SQLSMALLINT)_fraction_digits,
+			_int_buffer,
+			sizeof(_value));
+		return *(const SQL_TIMESTAMP_STRUCT *)_int_buffer;
+	}
+
+	// Set parameter as exact decimal
+	const decimal & param_impl::set_as_decimal(const decimal & _value)
+	{
+		_int_array_rows = 0;
+		_int_decimal = _value;
+		if ((_int_decimal.precision < 1) || (_int_decimal.precision > 38))
+			_int_decimal.precision = 38;
+
+		SQL_NUMERIC_STRUCT num = _int_decimal.as_numeric();
+		memcpy(_int_buffer, &num, sizeof(num));
+		_int_SLOIP = sizeof(num);
+		bind(SQL_C_NUMERIC,
+			SQL_DECIMAL,
+			(SQLULEN)_int_decimal.precision,
+			(SQLSMALLINT)_int_decimal.scale,
+			_int_buffer,
+			sizeof(num));
+		return _int_decimal;
+	}
+
+	// Set parameter to NULL
+	bool param_impl::set_as_null()
+	{
+		_int_array_rows = 0;
+		_int_SLOIP = SQL_NULL_DATA;
+
+		// Keep the current binding, only the indicator changes
+		if (b_bound)
+			return true;
+
+		return bind(SQL_C_CHAR, SQL_VARCHAR, 1, 0, _int_buffer, sizeof(_int_buffer));
+	}
+
+	// Set parameter to be read from a data source at execution
+	bool param_impl::set_as_stream(data_source & _source, bool _binary, SQLLEN _length)
+	{
+		_int_array_rows = 0;
+		p_source = &_source;
+
+		// The parameter itself is the token that SQLParamData returns
+		_int_SLOIP = (_length < 0)?SQL_DATA_AT_EXEC:SQL_LEN_DATA_AT_EXEC(_length);
+		SQLULEN column_size = (SQLULEN)((_length < 0)?0:_length);
+		if (!_binary)
+			column_size /= sizeof(TCHAR);
+		return bind(_binary?SQL_C_BINARY:SQL_C_TCHAR,
+			_binary?SQL_LONGVARBINARY:SQL_LONGVARCHAR,
+			column_size,
+			0,
+			(SQLPOINTER)this,
+			0);
+	}
+
+	// Set parameter as array of strings
+	bool param_impl::set_as_string_array(const std::vector<_tstring> & _values)
+	{
+		size_t max_chars = 1;
+		size_t i;
+		for(i = 0;i < _values.size();i++)
+			if (_values[i].size() > max_chars)
+				max_chars = _values[i].size();
+
+		// Save strings internally, one fixed width slot per row
+		const SQLLEN width = (SQLLEN)((max_chars + 1) * sizeof(TCHAR));
+		_int_array.assign(width * (_values.empty()?1:_values.size()), 0);
+		_int_array_SLOIP.resize(_values.size()?_values.size():1);
+		for(i = 0;i < _values.size();i++)
+		{
+			memcpy(&_int_array[i * width], _values[i].c_str(), _values[i].size() * sizeof(TCHAR));
+			_int_array_SLOIP[i] = (SQLLEN)(_values[i].size() * sizeof(TCHAR));
+		}
+		_int_array_rows = _values.size();
+		b_bound = false;
+
+		p_stmt->stop_prefetch();
+		p_stmt->release_param_slot(par_num);
+		TIODBC_STATS_CALL(p_stmt, bind_parameter);
+		RETCODE rc = SQLBindParameter(stmt_h,
+			par_num,
+			SQL_PARAM_INPUT,
+			SQL_C_TCHAR,
+			SQL_CHAR,
+			(SQLULEN)max_chars,
+			0,
+			(SQLPOINTER)&_int_array[0],
+			width,
+			&_int_array_SLOIP[0]);
+		return TIODBC_SUCCESS_CODE(rc);
+	}
+
+	// Set parameter as array of longs
+	bool param_impl::set_as_long_array(const std::vector<long> & _values)
+	{
+		_int_array_rows = _values.size();
+		b_bound = false;
+		p_stmt->stop_prefetch();
+		p_stmt->release_param_slot(par_num);
+		if (sizeof(long) > sizeof(SQLINTEGER))
+			return __bind_param_array<SQLBIGINT>(p_stmt, stmt_h, par_num, SQL_C_SBIGINT, SQL_BIGINT, _int_array, _values);
+		return __bind_param_array<SQLINTEGER>(p_stmt, stmt_h, par_num, SQL_C_SLONG, SQL_INTEGER, _int_array, _values);
+	}
+
+	// Set parameter as array of unsigned longs
+	bool param_impl::set_as_unsigned_long_array(const std::vector<unsigned long> & _values)
+	{
+		_int_array_rows = _values.size();
+		b_bound = false;
+		p_stmt->stop_prefetch();
+		p_stmt->release_param_slot(par_num);
+		if (sizeof(unsigned long) > sizeof(SQLUINTEGER))
+			return __bind_param_array<SQLUBIGINT>(p_stmt, stmt_h, par_num, SQL_C_UBIGINT, SQL_BIGINT, _int_array, _values);
+		return __bind_param_array<SQLUINTEGER>(p_stmt, stmt_h, par_num, SQL_C_ULONG, SQL_INTEGER, _int_array, _values);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// STATEMENT IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	//! @cond INTERNAL_FUNCTIONS
+
+	// Choose the C type and buffer size that a column will be bound with for block fetching
+	bool __rowset_binding(SQLSMALLINT _sql_type, SQLULEN _col_size, SQLSMALLINT & _c_type, SQLLEN & _width)
+	{
+		switch(_sql_type)
+		{
+		case SQL_BIT:
+		case SQL_TINYINT:
+		case SQL_SMALLINT:
+		case SQL_INTEGER:
+		case SQL_BIGINT:
+			_c_type = SQL_C_SBIGINT;
+			_width = sizeof(SQLBIGINT);
+			return true;
+		case SQL_REAL:
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			_c_type = SQL_C_DOUBLE;
+			_width = sizeof(double);
+			return true;
+		case SQL_DECIMAL:
+		case SQL_NUMERIC:
+			// Precision and scale are set on the row descriptor after binding
+			_c_type = SQL_C_NUMERIC;
+			_width = sizeof(SQL_NUMERIC_STRUCT);
+			return true;
+		case SQL_TYPE_TIMESTAMP:
+			_c_type = SQL_C_TYPE_TIMESTAMP;
+			_width = sizeof(SQL_TIMESTAMP_STRUCT);
+			return true;
+		case SQL_GUID:
+			_c_type = SQL_C_GUID;
+			_width = sizeof(SQLGUID);
+			return true;
+		case SQL_BINARY:
+		case SQL_VARBINARY:
+		case SQL_LONGVARBINARY:
+			if ((_col_size == 0) || (_col_size > TIODBC_MAX_BOUND_SIZE))
+				return false;
+			_c_type = SQL_C_BINARY;
+			_width = (SQLLEN)_col_size;
+			return true;
+		}
+
+		// Everything else as text, with room for 4 bytes per character of multibyte encodings
+		if ((_col_size == 0) || (_col_size > TIODBC_MAX_BOUND_SIZE / 4))
+			return false;
+		_c_type = SQL_C_TCHAR;
+		_width = (SQLLEN)(_col_size * 4 + sizeof(TCHAR));
+		return true;
+	}
+
+	// Fold an ASCII letter to lower case
+	inline TCHAR __fold_case(TCHAR _c)
+	{
+		return ((_c >= 'A') && (_c <= 'Z'))?(TCHAR)(_c - 'A' + 'a'):_c;
+	}
+
+	// Hash a column name case-insensitively (FNV-1a)
+	size_t __hash_name(const _tstring & _name)
+	{
+		unsigned long hash = 2166136261UL;
+		for(size_t i = 0;i < _name.size();i++)
+		{
+			hash ^= (unsigned long)__fold_case(_name[i]);
+			hash = (hash * 16777619UL) & 0xffffffffUL;
+		}
+		return (size_t)hash;
+	}
+
+	// Compare column names case-insensitively
+	bool __same_name(const _tstring & _a, const _tstring & _b)
+	{
+		if (_a.size() != _b.size())
+			return false;
+		for(size_t i = 0;i < _a.size();i++)
+			if (__fold_case(_a[i]) != __fold_case(_b[i]))
+				return false;
+		return true;
+	}
+
+	// Get the size of a fixed size C type (0 for variable size ones)
+	SQLLEN __c_type_size(SQLSMALLINT _c_type)
+	{
+		switch(_c_type)
+		{
+		case SQL_C_BIT:			return sizeof(unsigned char);
+		case SQL_C_SSHORT:
+		case SQL_C_USHORT:		return sizeof(SQLSMALLINT);
+		case SQL_C_SLONG:
+		case SQL_C_ULONG:		return sizeof(SQLINTEGER);
+		case SQL_C_SBIGINT:
+		case SQL_C_UBIGINT:		return sizeof(SQLBIGINT);
+		case SQL_C_FLOAT:		return sizeof(float);
+		case SQL_C_DOUBLE:		return sizeof(double);
+		}
+		return 0;
+	}
+
+	// Check if a row of a rowset holds data
+	bool __row_fetched(SQLUSMALLINT _status)
+	{
+		return (_status != SQL_ROW_NOROW)
+			&& (_status != SQL_ROW_ERROR)
+			&& (_status != SQL_ROW_DELETED);
+	}
+
+	// Size of one row of block cursor buffers
+	template<class TColumns>
+	SQLLEN __bound_row_width(const TColumns & _columns)
+	{
+		SQLLEN width = 0;
+		for(size_t i = 0;i < _columns.size();i++)
+			width += _columns[i].width;
+		return width;
+	}
+
+	// Choose the value type and the C type that a column will be fetched with by columns
+	bool __columnar_binding(SQLSMALLINT _sql_type, SQLULEN _col_size, bool _unsigned,
+		result_column & _col, SQLSMALLINT & _c_type, SQLLEN & _width)
+	{
+		switch(_sql_type)
+		{
+		case SQL_BIT:
+		case SQL_TINYINT:
+		case SQL_SMALLINT:
+		case SQL_INTEGER:
+		case SQL_BIGINT:
+			// Unsigned INTEGER does not fit in 32 bits
+			if ((_sql_type != SQL_BIGINT) && !(_unsigned && (_sql_type == SQL_INTEGER)))
+			{
+				_col.type = result_column::int32_type;
+				_col.width = sizeof(SQLINTEGER);
+				_c_type = SQL_C_SLONG;
+				_width = sizeof(SQLINTEGER);
+				return true;
+			}
+			_col.type = result_column::int64_type;
+			_col.width = sizeof(SQLBIGINT);
+			_c_type = SQL_C_SBIGINT;
+			_width = sizeof(SQLBIGINT);
+			return true;
+		case SQL_REAL:
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			_col.type = result_column::double_type;
+			_col.width = sizeof(double);
+			_c_type = SQL_C_DOUBLE;
+			_width = sizeof(double);
+			return true;
+		case SQL_GUID:
+			_col.type = result_column::fixed_binary_type;
+			_col.width = sizeof(SQLGUID);
+			_c_type = SQL_C_GUID;
+			_width = sizeof(SQLGUID);
+			return true;
+		case SQL_BINARY:
+			if ((_col_size > 0) && (_col_size <= TIODBC_MAX_BOUND_SIZE))
+			{
+				_col.type = result_column::fixed_binary_type;
+				_col.width = _col_size;
+				_c_type = SQL_C_BINARY;
+				_width = (SQLLEN)_col_size;
+				return true;
+			}
+			// fall through
+		case SQL_VARBINARY:
+		case SQL_LONGVARBINARY:
+			_col.type = result_column::binary_type;
+			_col.width = 0;
+			_c_type = SQL_C_BINARY;
+			_width = (SQLLEN)_col_size;
+			return (_col_size > 0) && (_col_size <= TIODBC_MAX_BOUND_SIZE);
+		}
+
+		// Everything else as text, CHAR(n) is variable length too
+		// as its size in bytes depends on the encoding
+		_col.type = result_column::string_type;
+		_col.width = 0;
+		_c_type = SQL_C_CHAR;
+		_width = (SQLLEN)(_col_size * 4 + 1);
+		return (_col_size > 0) && (_col_size <= TIODBC_MAX_BOUND_SIZE / 4);
+	}
+
+	// Append a value to a column, _data is NULL for NULL values
+	void __column_append(result_column & _col, const char * _data, size_t _size)
+	{
+		if (_col.width)
+		{	// Fixed size slot
+			size_t pos = _col.values.size();
+			_col.values.resize(pos + _col.width, 0);
+			if (_data)
+				memcpy(&_col.values[pos], _data, (_size < _col.width)?_size:_col.width);
+		}
+		else if (_data)
+			_col.values.insert(_col.values.end(), _data, _data + _size);
+
+		// Mark validity and close the value
+		size_t row = _col.length++;
+		if ((row % 8) == 0)
+			_col.validity.push_back(0);
+		if (_data)
+			_col.validity[row / 8] |= (unsigned char)(1 << (row % 8));
+		else
+			_col.null_count++;
+		if (!_col.width)
+			_col.offsets.push_back((SQLINTEGER)_col.values.size());
+	}
+
+	// Append a value of a block cursor buffer to a column
+	void __column_append_cell(result_column & _col, SQLSMALLINT _c_type, const char * _cell, SQLLEN _ind, SQLLEN _width)
+	{
+		if (_ind == SQL_NULL_DATA)
+		{
+			__column_append(_col, NULL, 0);
+			return;
+		}
+
+		// Truncated values keep what fits in buffer
+		SQLLEN room = (_c_type == SQL_C_CHAR)?_width - 1:_width;
+		__column_append(_col, _cell, (size_t)(((_ind < 0) || (_ind > room))?room:_ind));
+	}
+
+	// Append a value of the current row to a column with SQLGetData
+	bool __column_append_data(const statement * _owner, HSTMT _stmt, int _col_num, result_column & _col, SQLSMALLINT _c_type)
+	{
+		char buf[1024];
+		SQLLEN ind;
+		RETCODE rc;
+
+		if (_col.width && (_c_type != SQL_C_BINARY))
+		{	// Numbers and GUIDs
+			TIODBC_STATS_CALL(_owner, get_data);
+			rc = SQLGetData(_stmt, (SQLUSMALLINT)_col_num, _c_type, buf, sizeof(buf), &ind);
+			if (!TIODBC_SUCCESS_CODE(rc))
+				return false;
+			__column_append(_col, (ind == SQL_NULL_DATA)?NULL:buf, _col.width);
+			TIODBC_STATS_ADD(_owner, bytes_fetched, (ind == SQL_NULL_DATA)?0:_col.width);
+			return true;
+		}
+
+		// Variable size, read it in chunks
+		std::string value;
+		SQLLEN room = (_c_type == SQL_C_CHAR)?sizeof(buf) - 1:sizeof(buf);
+		while(true)
+		{
+			TIODBC_STATS_CALL(_owner, get_data);
+			rc = SQLGetData(_stmt, (SQLUSMALLINT)_col_num, _c_type, buf, sizeof(buf), &ind);
+			if (rc == SQL_NO_DATA)
+				break;
+			if (!TIODBC_SUCCESS_CODE(rc))
+				return false;
+			if (ind == SQL_NULL_DATA)
+			{
+				__column_append(_col, NULL, 0);
+				return true;
+			}
+			value.append(buf, ((ind < 0) || (ind > room))?room:ind);
+			if (rc == SQL_SUCCESS)
+				break;
+		}
+		__column_append(_col, value.data(), value.size());
+		TIODBC_STATS_ADD(_owner, bytes_fetched, value.size());
+		return true;
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Bounded queue between one producer and one consumer thread
+	class __spsc_queue
+	{
+	private:
+		std::vector<size_t> m_items;
+		std::atomic<size_t> n_pushed;	// Written only by producer
+		std::atomic<size_t> n_popped;	// Written only by consumer
+		std::atomic<bool> b_closed;
+		std::mutex m_mutex;				// Only for sleeping on empty or full queue
+		std::condition_variable m_changed;
+
+		// Wake the other side if it sleeps
+		void notify()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+			}
+			m_changed.notify_one();
+		}
+
+		// Uncopiable
+		__spsc_queue(const __spsc_queue &);
+		__spsc_queue & operator=(const __spsc_queue &);
+
+	public:
+		explicit __spsc_queue(size_t _capacity)
+			:m_items(_capacity), n_pushed(0), n_popped(0), b_closed(false)
+		{}
+
+		// Add an item, waiting while the queue is full. False if it was closed.
+		bool push(size_t _item)
+		{
+			size_t pushed = n_pushed.load(std::memory_order_relaxed);
+			if (pushed - n_popped.load(std::memory_order_acquire) >= m_items.size())
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_changed.wait(lock, [&]() {
+					return b_closed || (pushed - n_popped.load(std::memory_order_acquire) < m_items.size());
+				});
+			}
+			if (b_closed)
+				return false;
+
+			m_items[pushed % m_items.size()] = _item;
+			n_pushed.store(pushed + 1, std::memory_order_release);
+			notify();
+			return true;
+		}
+
+		// Take an item, waiting while the queue is empty. False if it was closed.
+		bool pop(size_t & _item)
+		{
+			size_t popped = n_popped.load(std::memory_order_relaxed);
+			if (n_pushed.load(std::memory_order_acquire) == popped)
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_changed.wait(lock, [&]() {
+					return b_closed || (n_pushed.load(std::memory_order_acquire) != popped);
+				});
+			}
+			if (b_closed)
+				return false;
+
+			_item = m_items[popped % m_items.size()];
+			n_popped.store(popped + 1, std::memory_order_release);
+			notify();
+			return true;
+		}
+
+		// Wake both sides and make them fail
+		void close()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				b_closed = true;
+			}
+			m_changed.notify_all();
+		}
+	};
+
+	// Buffers and thread of statement::set_prefetch()
+	struct __prefetch_state
+	{
+		// A prefetched rowset
+		struct rowset
+		{
+			std::vector<SQLUSMALLINT> row_status;
+			SQLULEN rows;			//!< Rows fetched
+			RETCODE rc;				//!< Result of SQLFetch
+		};
+
+		HSTMT stmt_h;
+		std::vector<char> m_buffer;		//!< Column buffers of all rowsets, one after the other
+		size_t rowset_bytes;			//!< Size of column buffers of one rowset
+		std::vector<const char *> m_values;			//!< Values of every column in first rowset
+		std::vector<const SQLLEN *> m_indicators;	//!< Indicators of every column in first rowset
+		std::vector<rowset> m_rowsets;
+		__spsc_queue m_free;			//!< Rowsets that can be fetched into
+		__spsc_queue m_fetched;			//!< Rowsets fetched, in order
+		size_t n_held;					//!< Rowset used by statement (or m_rowsets.size())
+		RETCODE last_rc;				//!< Result of the last fetch given to statement
+		SQLULEN bind_offset;			//!< Bind offset of the driver, selects the rowset to fetch into
+		SQLULEN rows_fetched;			//!< Rows fetched pointer of the driver
+		std::vector<SQLUSMALLINT> m_row_status;	//!< Row status array of the driver
+		std::thread m_thread;
+
+		__prefetch_state(HSTMT _stmt_h, size_t _rowsets, size_t _rows)
+			:stmt_h(_stmt_h),
+			rowset_bytes(0),
+			m_rowsets(_rowsets),
+			m_free(_rowsets),
+			m_fetched(_rowsets),
+			n_held(_rowsets),
+			last_rc(SQL_SUCCESS),
+			bind_offset(0),
+			rows_fetched(0),
+			m_row_status(_rows)
+		{
+			for(size_t k = 0;k < _rowsets;k++)
+				m_rowsets[k].row_status.resize(_rows);
+		}
+
+		// Body of the prefetch thread
+		void run()
+		{
+			size_t index;
+			while(m_free.pop(index))
+			{
+				// The driver reads the offset at every fetch
+				rowset & r = m_rowsets[index];
+				bind_offset = index * rowset_bytes;
+				r.rc = SQLFetch(stmt_h);
+				r.rows = TIODBC_SUCCESS_CODE(r.rc)?rows_fetched:0;
+				if (r.rows)
+					memcpy(&r.row_status[0], &m_row_status[0], r.rows * sizeof(SQLUSMALLINT));
+
+				// The end of results or an error is the last one
+				if (!m_fetched.push(index) || !TIODBC_SUCCESS_CODE(r.rc))
+					break;
+			}
+		}
+	};
+#endif // TIODBC_HAS_CXX11
+
+	//! @endcond
+
+	// Default constructor
+	statement::statement()
+		:stmt_h(NULL),
+		b_open(false),
+		p_conn(NULL),
+		b_cached(false),
+		conn_serial(0),
+		p_query(NULL),
+		query_fetch_start(0),
+		rowset_rows(1),
+		rows_fetched(0),
+		rowset_pos(0),
+		b_rowset_bound(false),
+		prefetch_rowsets(0),
+		p_prefetch(NULL),
+		b_prefetch_ready(false),
+		b_described(false),
+		fetch_serial(1),
+		saved_error_serial(0),
+		async_op(async_none),
+		async_query_start(0),
+		b_async_result(false),
+		params_processed(0)
+	{
+	}
+
+	// Construct and initialize
+	statement::statement(connection & _conn, const _tstring & _stmt)
+		:stmt_h(NULL),
+		b_open(false),
+		p_conn(NULL),
+		b_cached(false),
+		conn_serial(0),
+		p_query(NULL),
+		query_fetch_start(0),
+		rowset_rows(1),
+		rows_fetched(0),
+		rowset_pos(0),
+		b_rowset_bound(false),
+		prefetch_rowsets(0),
+		p_prefetch(NULL),
+		b_prefetch_ready(false),
+		b_described(false),
+		fetch_serial(1),
+		saved_error_serial(0),
+		async_op(async_none),
+		async_query_start(0),
+		b_async_result(false),
+		params_processed(0)
+	{
+		prepare(_conn, _stmt);
+	}
+
+	// Destructor
+	statement::~statement()
+	{
+		close();
+	}
+
+	// Used to create a statement (used automatically by the other functions)
+	bool statement::open(connection & _conn)
+	{
+		RETCODE rc;
+		// close previous one
+		close();
+
+		// Allocate statement
+		p_conn = &_conn;
+		TIODBC_STATS_CALL(this, alloc_handle);
+		rc = SQLAllocHandle(SQL_HANDLE_STMT, _conn.native_dbc_handle(), &stmt_h);
+		if (!TIODBC_SUCCESS_CODE(rc))
+		{
+			stmt_h = NULL;
+			b_open = false;
+			p_conn = NULL;
+			return false;
+		}
+
+		b_open = true;
+		_conn.m_users.push_back(this);
+		return true;
+	}
+
+	// Check if it is an open statement
+	bool statement::is_open() const
+	{
+		return b_open;
+	}
+
+	// Close statement
+	void statement::close()
+	{
+		if (is_open())
+		{
+			// Free parameters
+			param_it it;
+			for(it = m_params.begin();it != m_params.end();it++)
+				delete it->second;
+			m_params.clear();
+			m_param_slots.clear();
+			m_param_texts.clear();
+
+			// Stop asynchronous operation if any, a cached handle must be synchronous
+			if (async_op != async_none)
+			{
+				TIODBC_STATS_CALL(this, cancel);
+				SQLCancel(stmt_h);
+				TIODBC_STATS_CALL(this, stmt_attr);
+				SQLSetStmtAttr(stmt_h, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, 0);
+				complete_async(false);
+			}
+
+			// Free result if any
+			free_results();
+
+			// Free handle or give it back to the cache
+			if (b_cached)
+			{
+				TIODBC_STATS_CALL(this, free_stmt);
+				SQLFreeStmt(stmt_h, SQL_RESET_PARAMS);
+				p_conn->return_cached_statement(cached_sql, stmt_h, conn_serial);
+			}
+			else
+			{
+				TIODBC_STATS_CALL(this, free_handle);
+				SQLFreeHandle(SQL_HANDLE_STMT, stmt_h);
+			}
+			stmt_h = NULL;
+			p_conn->m_users.remove(this);
+		}
+
+		// Counters are no longer added to the connection
+		p_conn = NULL;
+		b_open = false;
+		b_cached = false;
+	}
+
+	// Free results (aka SQLCloseCursor)
+	void statement::free_results()
+	{
+		// Close cursor if we have an open connection
+		if (is_open())
+		{
+			stop_prefetch();
+			TIODBC_STATS_CALL(this, close_cursor);
+			SQLCloseCursor(stmt_h);
+			unbind_rowset();
+		}
+		fetch_serial++;
+		b_described = false;
+		m_columns.clear();
+		m_name_index.clear();
+		query_fetch_start = 0;
+	}
+
+	// Bind columns of result set for block fetching
+	bool statement::bind_rowset()
+	{
+		RETCODE rc;
+
+		unbind_rowset();
+
+		if (!describe() || m_columns.empty())
+			return false;
+		int total_cols = (int)m_columns.size();
+
+		// Allocate buffers for all columns
+		m_bound_columns.resize(total_cols);
+		for(int i = 0;i < total_cols;i++)
+		{
+			bound_column & col = m_bound_columns[i];
+			if (!__rowset_binding(m_columns[i].sql_type, m_columns[i].size, col.c_type, col.width))
+			{	// Cannot be buffered, fetch row by row
+				m_bound_columns.clear();
+				return false;
+			}
+			col.data.resize(col.width * rowset_rows);
+			col.indicators.resize(rowset_rows);
+			col.p_values = &col.data[0];
+			col.p_indicators = &col.indicators[0];
+		}
+		m_row_status.resize(rowset_rows);
+
+		// Bind them
+		b_rowset_bound = true;
+		for(int i = 0;i < total_cols;i++)
+		{
+			bound_column & col = m_bound_columns[i];
+			if (!bind_rowset_column(i + 1, &col.data[0], &col.indicators[0]))
+			{
+				unbind_rowset();
+				return false;
+			}
+		}
+
+		TIODBC_STATS_CALLS(this, stmt_attr, 4);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, &m_row_status[0], 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0);
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset_rows, 0);
+		if (!TIODBC_SUCCESS_CODE(rc))
+		{
+			unbind_rowset();
+			return false;
+		}
+
+		// The thread starts when the application reads the rows
+		b_prefetch_ready = (prefetch_rowsets > 0);
+		return true;
+	}
+
+	// Bind a column of the result set to block cursor buffers
+	bool statement::bind_rowset_column(int _col_num, char * _values, SQLLEN * _indicators)
+	{
+		const bound_column & col = m_bound_columns[_col_num - 1];
+		TIODBC_STATS_CALL(this, bind_col);
+		RETCODE rc = SQLBindCol(stmt_h, (SQLUSMALLINT)_col_num, col.c_type, _values, col.width, _indicators);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+		if (col.c_type != SQL_C_NUMERIC)
+			return true;
+
+		// Numerics are converted with the precision and scale of the column
+		int precision, scale;
+		__numeric_precision_scale(m_columns[_col_num - 1], precision, scale);
+		return __set_numeric_desc(this, stmt_h, SQL_ATTR_APP_ROW_DESC, _col_num, precision, scale, _values);
+	}
+
+	// Start prefetching the rowsets of the bound result set
+	bool statement::start_prefetch()
+	{
+#ifdef TIODBC_HAS_CXX11
+		RETCODE rc = SQL_SUCCESS;
+
+		if (p_prefetch || !b_rowset_bound)
+			return false;
+
+		// One rowset is processed while the others are fetched
+		size_t total_cols = m_bound_columns.size();
+		__prefetch_state * state = new __prefetch_state(stmt_h, prefetch_rowsets + 1, rowset_rows);
+		std::vector<size_t> value_pos(total_cols), indicator_pos(total_cols);
+		for(size_t i = 0;i < total_cols;i++)
+		{
+			value_pos[i] = state->rowset_bytes;
+			state->rowset_bytes += (m_bound_columns[i].width * rowset_rows + 15) & ~(size_t)15;
+			indicator_pos[i] = state->rowset_bytes;
+			state->rowset_bytes += (sizeof(SQLLEN) * rowset_rows + 15) & ~(size_t)15;
+		}
+		state->m_buffer.resize(state->rowset_bytes * state->m_rowsets.size() + 15);
+		char * base = &state->m_buffer[0];
+		base += (16 - ((size_t)base & 15)) & 15;
+
+		// Bind to the first rowset, the bind offset moves the driver to the others
+		state->m_values.resize(total_cols);
+		state->m_indicators.resize(total_cols);
+		for(size_t i = 0;(i < total_cols) && TIODBC_SUCCESS_CODE(rc);i++)
+		{
+			state->m_values[i] = base + value_pos[i];
+			state->m_indicators[i] = (const SQLLEN *)(base + indicator_pos[i]);
+			if (!bind_rowset_column((int)i + 1, base + value_pos[i], (SQLLEN *)(base + indicator_pos[i])))
+				rc = SQL_ERROR;
+		}
+		if (TIODBC_SUCCESS_CODE(rc))
+		{
+			TIODBC_STATS_CALL(this, stmt_attr);
+			rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_OFFSET_PTR, &state->bind_offset, 0);
+		}
+		if (TIODBC_SUCCESS_CODE(rc))
+		{
+			TIODBC_STATS_CALLS(this, stmt_attr, 2);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &state->rows_fetched, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, &state->m_row_status[0], 0);
+			for(size_t k = 0;k < state->m_rowsets.size();k++)
+				state->m_free.push(k);
+			try
+			{
+				state->m_thread = std::thread(&__prefetch_state::run, state);
+			}
+			catch(const std::system_error &)
+			{
+				rc = SQL_ERROR;
+			}
+		}
+		if (!TIODBC_SUCCESS_CODE(rc))
+		{
+			TIODBC_STATS_CALLS(this, stmt_attr, 3);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_OFFSET_PTR, NULL, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, &m_row_status[0], 0);
+			delete state;
+
+			// Fetch them in this thread, with the buffers of bind_rowset()
+			for(size_t i = 0;i < total_cols;i++)
+				if (!bind_rowset_column((int)i + 1, &m_bound_columns[i].data[0], &m_bound_columns[i].indicators[0]))
+				{
+					unbind_rowset();
+					break;
+				}
+			return false;
+		}
+
+		// Old buffers are not bound anymore
+		for(size_t i = 0;i < total_cols;i++)
+		{
+			std::vector<char>().swap(m_bound_columns[i].data);
+			std::vector<SQLLEN>().swap(m_bound_columns[i].indicators);
+		}
+		p_prefetch = state;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// Stop the prefetch thread and free its buffers
+	void statement::stop_prefetch()
+	{
+#ifdef TIODBC_HAS_CXX11
+		if (!p_prefetch)
+			return;
+
+		// Wait the fetch in progress
+		p_prefetch->m_free.close();
+		p_prefetch->m_fetched.close();
+		p_prefetch->m_thread.join();
+		TIODBC_STATS_CALL(this, stmt_attr);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_OFFSET_PTR, NULL, 0);
+
+		delete p_prefetch;
+		p_prefetch = NULL;
+
+		// Columns are bound to the freed buffers
+		unbind_rowset();
+#endif
+	}
+
+	// Take the next prefetched rowset, returns the code of its SQLFetch
+	RETCODE statement::next_prefetched_rowset()
+	{
+#ifdef TIODBC_HAS_CXX11
+		__prefetch_state & state = *p_prefetch;
+
+		// Give back the processed one
+		if (state.n_held < state.m_rowsets.size())
+		{
+			m_row_status.swap(state.m_rowsets[state.n_held].row_status);
+			state.m_free.push(state.n_held);
+			state.n_held = state.m_rowsets.size();
+		}
+		if (!TIODBC_SUCCESS_CODE(state.last_rc))
+			return state.last_rc;
+
+		size_t index;
+		if (!state.m_fetched.pop(index))
+			return SQL_ERROR;
+
+		// SQLFetch of the thread is counted here, statistics are not thread-safe
+		TIODBC_STATS_CALL(this, fetch);
+		__prefetch_state::rowset & r = state.m_rowsets[index];
+		state.last_rc = r.rc;
+		rows_fetched = r.rows;
+		if (!TIODBC_SUCCESS_CODE(r.rc))
+		{	// The thread has stopped, its diagnostics can be read
+			if (r.rc != SQL_NO_DATA)
+				save_error();
+			return r.rc;
+		}
+
+		// Read the columns from its buffers
+		size_t offset = index * state.rowset_bytes;
+		for(size_t i = 0;i < m_bound_columns.size();i++)
+		{
+			m_bound_columns[i].p_values = state.m_values[i] + offset;
+			m_bound_columns[i].p_indicators = (const SQLLEN *)((const char *)state.m_indicators[i] + offset);
+		}
+		m_row_status.swap(r.row_status);
+		state.n_held = index;
+		return r.rc;
+#else
+		return SQL_ERROR;
+#endif
+	}
+
+	// Unbind block fetching buffers
+	void statement::unbind_rowset()
+	{
+		stop_prefetch();
+		if (b_rowset_bound)
+		{
+			TIODBC_STATS_CALL(this, free_stmt);
+			SQLFreeStmt(stmt_h, SQL_UNBIND);
+			m_numeric_ard.clear();
+			TIODBC_STATS_CALLS(this, stmt_attr, 3);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)1, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, NULL, 0);
+		}
+		m_bound_columns.clear();
+		m_row_status.clear();
+		b_rowset_bound = false;
+		b_prefetch_ready = false;
+		rows_fetched = 0;
+		rowset_pos = 0;
+	}
+
+	// Send the values of data-at-execution parameters
+	RETCODE statement::put_stream_data()
+	{
+		SQLPOINTER token;
+		RETCODE rc;
+
+		while((TIODBC_STATS_CALL(this, param_data), rc = SQLParamData(stmt_h, &token)) == SQL_NEED_DATA)
+		{
+			param_impl * par = (param_impl *)token;
+			if (!par || !par->p_source)
+			{
+				TIODBC_STATS_CALL(this, cancel);
+				SQLCancel(stmt_h);
+				return SQL_ERROR;
+			}
+
+			if (m_stream_buffer.size() < TIODBC_STREAM_CHUNK_SIZE)
+				m_stream_buffer.resize(TIODBC_STREAM_CHUNK_SIZE);
+
+			// Text is sent in whole characters
+			size_t chunk_size = m_stream_buffer.size();
+			if (par->bound_c_type != SQL_C_BINARY)
+				chunk_size -= chunk_size % sizeof(TCHAR);
+
+			// Send it chunk by chunk, an empty value is sent as one empty chunk
+			size_t got;
+			bool b_sent = false;
+			do
+			{
+				if (!par->p_source->read(&m_stream_buffer[0], chunk_size, got))
+				{
+					TIODBC_STATS_CALL(this, cancel);
+					SQLCancel(stmt_h);
+					return SQL_ERROR;
+				}
+				if (got || !b_sent)
+				{
+					TIODBC_STATS_CALL(this, put_data);
+					rc = SQLPutData(stmt_h, &m_stream_buffer[0], (SQLLEN)got);
+					if (!TIODBC_SUCCESS_CODE(rc))
+					{
+						TIODBC_STATS_CALL(this, cancel);
+						SQLCancel(stmt_h);
+						return rc;
+					}
+					b_sent = true;
+				}
+			} while(got);
+		}
+		return rc;
+	}
+
+	// Bind the first columns of result set for block fetching with the given C types
+	bool statement::bind_typed(const SQLSMALLINT * _c_types, int _count)
+	{
+		RETCODE rc;
+
+		// Rows fetched ahead would be lost
+		if (p_prefetch)
+			return false;
+
+		unbind_rowset();
+		fetch_serial++;
+		if (!describe() || ((int)m_columns.size() < _count) || (_count <= 0))
+			return false;
+
+		// Allocate buffers
+		SQLULEN block = (rowset_rows > 1)?rowset_rows:TIODBC_COLUMNAR_ROWS;
+		m_bound_columns.resize(_count);
+		for(int i = 0;i < _count;i++)
+		{
+			bound_column & col = m_bound_columns[i];
+			col.c_type = _c_types[i];
+			col.width = __c_type_size(_c_types[i]);
+			if (col.width == 0)
+			{	// Text as in rowset mode
+				SQLSMALLINT c_type;
+				if (!__rowset_binding(SQL_VARCHAR, m_columns[i].size, c_type, col.width))
+				{
+					m_bound_columns.clear();
+					return false;
+				}
+			}
+			col.data.resize(col.width * block);
+			col.indicators.resize(block);
+			col.p_values = &col.data[0];
+			col.p_indicators = &col.indicators[0];
+		}
+		m_row_status.resize(block);
+
+		// Bind them
+		b_rowset_bound = true;
+		for(int i = 0;i < _count;i++)
+		{
+			bound_column & col = m_bound_columns[i];
+			TIODBC_STATS_CALL(this, bind_col);
+			rc = SQLBindCol(stmt_h, (SQLUSMALLINT)(i + 1), col.c_type, &col.data[0], col.width, &col.indicators[0]);
+			if (!TIODBC_SUCCESS_CODE(rc))
+			{
+				unbind_rowset();
+				return false;
+			}
+		}
+
+		TIODBC_STATS_CALLS(this, stmt_attr, 4);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, &m_row_status[0], 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0);
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)block, 0);
+		if (!TIODBC_SUCCESS_CODE(rc))
+		{
+			unbind_rowset();
+			return false;
+		}
+		return true;
+	}
+
+	// Get the bound buffer of a column in the current row
+	const char * statement::typed_cell(int _col_num, SQLLEN & _ind, SQLLEN & _width) const
+	{
+		if (!b_rowset_bound
+			|| (_col_num < 1)
+			|| (_col_num > (int)m_bound_columns.size())
+			|| (rowset_pos >= rows_fetched))
+			return NULL;
+
+		const bound_column & col = m_bound_columns[_col_num - 1];
+		_ind = col.p_indicators[rowset_pos];
+		_width = col.width;
+		return col.p_values + rowset_pos * col.width;
+	}
+
+	// Read a column of the current row with SQLGetData
+	bool statement::get_data(int _col_num, SQLSMALLINT _c_type, void * _buf, SQLLEN _size, SQLLEN & _ind) const
+	{
+		if (b_rowset_bound)
+			return false;	// Unbound column of a block cursor
+		TIODBC_STATS_CALL(this, get_data);
+		RETCODE rc = SQLGetData(stmt_h, (SQLUSMALLINT)_col_num, _c_type, _buf, _size, &_ind);
+		return TIODBC_SUCCESS_CODE(rc);
+	}
+
+	// Set the number of rows that are fetched at once
+	bool statement::set_rowset_size(unsigned long _rows)
+	{
+		if (_rows == 0)
+			return false;
+		rowset_rows = _rows;
+		return true;
+	}
+
+	// Get the number of rows that are fetched at once
+	unsigned long statement::rowset_size() const
+	{
+		return (unsigned long)rowset_rows;
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Fetch rowsets on a background thread ahead of the application
+	void statement::set_prefetch(unsigned long _rowsets)
+	{
+		prefetch_rowsets = _rowsets;
+	}
+
+	// Get the number of rowsets fetched ahead
+	unsigned long statement::prefetch() const
+	{
+		return prefetch_rowsets;
+	}
+#endif // TIODBC_HAS_CXX11
+
+	// Fetch the remaining rows of the result set by columns
+	bool statement::fetch_columnar(columnar_result & _result, unsigned long _max_rows)
+	{
+		RETCODE rc;
+		TIODBC_STATS_TIMER(this, fetch_ns);
+
+		_result.rows = 0;
+		_result.columns.clear();
+		if (!is_open())
+			return false;
+
+		// Rows fetched ahead would be lost
+		if (p_prefetch)
+			return false;
+
+		// Replace buffers of fetch_next() with ours
+		unbind_rowset();
+		fetch_serial++;
+
+		if (!describe() || m_columns.empty())
+			return false;
+		int total_cols = (int)m_columns.size();
+
+		// Choose column types
+		std::vector<bound_column> buffers(total_cols);
+		bool b_bindable = true;
+		_result.columns.resize(total_cols);
+		for(int i = 0;i < total_cols;i++)
+		{
+			result_column & col = _result.columns[i];
+			SQLLEN is_unsigned = SQL_FALSE;
+			TIODBC_STATS_CALL(this, col_attribute);
+			SQLColAttribute(stmt_h, (SQLUSMALLINT)(i + 1), SQL_DESC_UNSIGNED, NULL, 0, NULL, &is_unsigned);
+
+			col.name = m_columns[i].name;
+			col.sql_type = m_columns[i].sql_type;
+			col.length = 0;
+			col.null_count = 0;
+			if (!__columnar_binding(col.sql_type, m_columns[i].size, is_unsigned == SQL_TRUE,
+				col, buffers[i].c_type, buffers[i].width))
+				b_bindable = false;
+			if (!col.width)
+				col.offsets.push_back(0);
+		}
+
+		// Bind columns for block fetching
+		SQLULEN block = (rowset_rows > 1)?rowset_rows:TIODBC_COLUMNAR_ROWS;
+		if (b_bindable)
+		{
+			m_row_status.resize(block);
+			b_rowset_bound = true;
+			for(int i = 0;(i < total_cols) && b_bindable;i++)
+			{
+				bound_column & buf = buffers[i];
+				buf.data.resize(buf.width * block);
+				buf.indicators.resize(block);
+				TIODBC_STATS_CALL(this, bind_col);
+				rc = SQLBindCol(stmt_h, (SQLUSMALLINT)(i + 1), buf.c_type, &buf.data[0], buf.width, &buf.indicators[0]);
+				b_bindable = TIODBC_SUCCESS_CODE(rc);
+			}
+			TIODBC_STATS_CALLS(this, stmt_attr, 3);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_STATUS_PTR, &m_row_status[0], 0);
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0);
+			if (!b_bindable)
+				unbind_rowset();
+		}
+
+		// Fetch rows
+		bool b_ok = true;
+		while(b_ok && ((_max_rows == 0) || (_result.rows < _max_rows)))
+		{
+			if (b_bindable)
+			{
+				SQLULEN rows = block;
+				if ((_max_rows != 0) && (_max_rows - _result.rows < rows))
+					rows = _max_rows - _result.rows;
+				TIODBC_STATS_CALL(this, stmt_attr);
+				rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rows, 0);
+				if (!TIODBC_SUCCESS_CODE(rc))
+				{
+					b_ok = false;
+					break;
+				}
+			}
+
+			TIODBC_STATS_CALL(this, fetch);
+			rc = SQLFetch(stmt_h);
+			if (rc == SQL_NO_DATA)
+			{
+				complete_query_fetch();
+				break;
+			}
+			if (!TIODBC_SUCCESS_CODE(rc))
+			{
+				b_ok = false;
+				break;
+			}
+
+			if (!b_bindable)
+			{	// Row by row
+				for(int i = 0;(i < total_cols) && b_ok;i++)
+					b_ok = __column_append_data(this, stmt_h, i + 1, _result.columns[i], buffers[i].c_type);
+				if (b_ok)
+				{
+					_result.rows++;
+					TIODBC_STATS_ADD(this, rows_fetched, 1);
+				}
+				continue;
+			}
+
+			TIODBC_STATS_ADD(this, rows_fetched, rows_fetched);
+			TIODBC_STATS_ADD(this, bytes_fetched, rows_fetched * __bound_row_width(buffers));
+
+			for(SQLULEN r = 0;r < rows_fetched;r++)
+			{
+				if (!__row_fetched(m_row_status[r]))
+					continue;
+				for(int i = 0;i < total_cols;i++)
+				{
+					const bound_column & buf = buffers[i];
+					__column_append_cell(_result.columns[i], buf.c_type,
+						&buf.data[r * buf.width], buf.indicators[r], buf.width);
+				}
+				_result.rows++;
+			}
+		}
+
+		unbind_rowset();
+		return b_ok;
+	}
+
+	// Prepare statement
+	bool statement::prepare(connection & _conn, const _tstring & _stmt)
+	{
+		RETCODE rc;
+		// Close previous
+		close();
+
+		// open a new one
+		if (!open(_conn))
+			return false;
+
+		// Prepare statement
+		TIODBC_STATS_TIMER(this, prepare_ns);
+		TIODBC_STATS_CALL(this, prepare);
+		rc = SQLPrepare(stmt_h, (SQLTCHAR *)_stmt.c_str(), SQL_NTS);
+
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+
+		profile_query(_stmt, true);
+		return true;
+	}
+
+
+	// Prepare statement reusing a cached one
+	bool statement::prepare_cached(connection & _conn, const _tstring & _stmt)
+	{
+		RETCODE rc;
+		// Close previous
+		close();
+
+		stmt_h = _conn.take_cached_statement(_stmt);
+		if (stmt_h)
+		{	// Already prepared
+			p_conn = &_conn;
+			b_open = true;
+			_conn.m_users.push_back(this);
+			profile_query(_stmt, false);
+		}
+		else
+		{
+			// open a new one
+			if (!open(_conn))
+				return false;
+
+			// Prepare statement
+			TIODBC_STATS_TIMER(this, prepare_ns);
+			TIODBC_STATS_CALL(this, prepare);
+			rc = SQLPrepare(stmt_h, (SQLTCHAR *)_stmt.c_str(), SQL_NTS);
+			if (!TIODBC_SUCCESS_CODE(rc))
+				return false;
+			profile_query(_stmt, true);
+		}
+
+		// Give it back to the connection on close
+		b_cached = true;
+		cached_sql = _stmt;
+		conn_serial = _conn.conn_serial;
+		return true;
+	}
+
+	// Execute direct a query
+	bool statement::execute_direct(connection & _conn, const _tstring & _query)
+	{
+		RETCODE rc;
+		// Close previous
+		close();
+
+		// open a new one
+		if (!open(_conn))
+			return false;
+
+		// Execute directly statement
+		TIODBC_STATS_TIMER(this, execute_ns);
+		TIODBC_STATS_ADD(this, executions, 1);
+		profile_query(_query, false);
+		unsigned long long query_start = start_query_timer();
+		TIODBC_STATS_CALL(this, exec_direct);
+		rc = SQLExecDirect(stmt_h, (SQLTCHAR *)_query.c_str(), SQL_NTS);
+		record_query_execution(query_start, TIODBC_SUCCESS_CODE(rc));
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+
+		// Prepare block cursor
+		if (rowset_rows > 1)
+			bind_rowset();
+		return true;
+	}
+
+	// Execute statement
+	bool statement::execute()
+	{
+		RETCODE rc;
+		if (!is_open())
+			return false;
+		stop_prefetch();
+
+		fetch_serial++;
+		b_described = false;
+		TIODBC_STATS_TIMER(this, execute_ns);
+		TIODBC_STATS_ADD(this, executions, 1);
+		unsigned long long query_start = start_query_timer();
+		TIODBC_STATS_CALL(this, execute);
+		rc = SQLExecute(stmt_h);
+		if (rc == SQL_NEED_DATA)
+			rc = put_stream_data();
+		record_query_execution(query_start, TIODBC_SUCCESS_CODE(rc));
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+
+		// Prepare block cursor
+		if (rowset_rows > 1)
+			bind_rowset();
+		return true;
+	}
+
+	// Copy parameters to the bound slots, bind the changed ones and execute
+	bool statement::execute_params(const __param_slot * _slots, int _count)
+	{
+		RETCODE rc;
+		if (!is_open())
+			return false;
+		stop_prefetch();
+
+		// Slots stay bound between executions unless the block moves
+		if (m_param_slots.size() < (size_t)_count)
+		{
+			m_param_slots.resize(_count);
+			m_param_texts.resize(_count);
+			for(size_t i = 0;i < m_param_slots.size();i++)
+				m_param_slots[i].c_type = 0;
+		}
+
+		bool b_ok = true;
+		for(int i = 0;(i < _count) && b_ok;i++)
+		{
+			const __param_slot & slot = _slots[i];
+			__param_slot & bound = m_param_slots[i];
+			bound.value = slot.value;
+			bound.ind = slot.ind;
+
+			// Strings are copied as they may not outlive the call, NULL values have no buffer
+			SQLPOINTER p_value = NULL;
+			if (slot.ptr)
+			{
+				_tstring & text = m_param_texts[i];
+				text.assign((const TCHAR *)slot.ptr, (size_t)slot.length / sizeof(TCHAR));
+				p_value = (SQLPOINTER)text.data();
+			}
+			else if (slot.length)
+				p_value = (SQLPOINTER)&bound.value;
+			if ((bound.c_type == slot.c_type)
+				&& (bound.sql_type == slot.sql_type)
+				&& (bound.ptr == p_value)
+				&& (bound.column_size >= slot.column_size))
+				continue;
+
+			TIODBC_STATS_CALL(this, bind_parameter);
+			rc = SQLBindParameter(stmt_h,
+				(SQLUSMALLINT)(i + 1),
+				SQL_PARAM_INPUT,
+				slot.c_type,
+				slot.sql_type,
+				slot.column_size,
+				0,
+				p_value,
+				slot.length,
+				&bound.ind);
+			b_ok = TIODBC_SUCCESS_CODE(rc);
+			bound.c_type = b_ok?slot.c_type:0;
+			bound.sql_type = slot.sql_type;
+			bound.ptr = p_value;
+			bound.length = slot.length;
+			bound.column_size = slot.column_size;
+
+			// The marker is no longer bound by param()
+			param_it it = m_params.find(i + 1);
+			if (it != m_params.end())
+				it->second->b_bound = false;
+		}
+		if (b_ok)
+			b_ok = execute();
+
+		if (!b_ok)
+			save_error();
+		return b_ok;
+	}
+
+	// Mark the slot of a marker as no longer bound by execute(args...)
+	void statement::release_param_slot(int _par_num)
+	{
+		if ((_par_num >= 1) && ((size_t)_par_num <= m_param_slots.size()))
+			m_param_slots[_par_num - 1].c_type = 0;
+	}
+
+	// Fetch next
+	bool statement::fetch_next()
+	{
+		RETCODE rc;
+		if (!is_open())
+			return false;
+
+		fetch_serial++;
+		TIODBC_STATS_TIMER(this, fetch_ns);
+		if (!b_rowset_bound)
+		{
+			TIODBC_STATS_CALL(this, fetch);
+			rc = SQLFetch(stmt_h);
+			if (TIODBC_SUCCESS_CODE(rc))
+			{
+				TIODBC_STATS_ADD(this, rows_fetched, 1);
+				return true;
+			}
+			if (rc == SQL_NO_DATA)
+				complete_query_fetch();
+			return false;
+		}
+
+		// Rowsets are prefetched once the application reads them
+		if (b_prefetch_ready)
+		{
+			b_prefetch_ready = false;
+			start_prefetch();
+		}
+
+		// Block cursor
+		while(true)
+		{
+			// Move inside the current rowset
+			while(++rowset_pos < rows_fetched)
+				if (__row_fetched(m_row_status[rowset_pos]))
+					return true;
+
+			// Fetch the next one
+			if (p_prefetch)
+				rc = next_prefetched_rowset();
+			else
+			{
+				TIODBC_STATS_CALL(this, fetch);
+				rc = SQLFetch(stmt_h);
+			}
+			if (!TIODBC_SUCCESS_CODE(rc))
+			{
+				if (rc == SQL_NO_DATA)
+					complete_query_fetch();
+				rows_fetched = 0;
+				return false;
+			}
+			TIODBC_STATS_ADD(this, rows_fetched, rows_fetched);
+			TIODBC_STATS_ADD(this, bytes_fetched, rows_fetched * __bound_row_width(m_bound_columns));
+
+			rowset_pos = 0;
+			if ((rows_fetched > 0) && __row_fetched(m_row_status[0]))
+				return true;
+		}
+	}
+
+	// Get a field by column number (1-based)
+	const field_impl statement::field(int _num) const
+	{	
+		return field_impl(this, _num);
+	}
+
+	// Count columns of the result
+	int statement::count_columns() const
+	{
+		if (!describe())
+			return -1;
+		return (int)m_columns.size();
+	}
+
+	// Describe the columns of the result set once
+	bool statement::describe() const
+	{
+		SQLSMALLINT total_cols;
+		RETCODE rc;
+
+		if (b_described)
+			return true;
+
+		m_columns.clear();
+		if (!is_open())
+			return false;
+
+		TIODBC_STATS_CALL(this, num_result_cols);
+		rc = SQLNumResultCols(stmt_h, &total_cols);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+
+		m_columns.resize(total_cols);
+		m_numeric_ard.clear();
+		std::vector<SQLTCHAR> name(256);
+		for(int i = 0;i < total_cols;i++)
+		{
+			column_descriptor & col = m_columns[i];
+			SQLSMALLINT name_len, nullable;
+			for(int pass = 0;pass < 2;pass++)
+			{
+				TIODBC_STATS_CALL(this, describe_col);
+				rc = SQLDescribeCol(stmt_h, (SQLUSMALLINT)(i + 1), &name[0], (SQLSMALLINT)name.size(), &name_len,
+					&col.sql_type, &col.size, &col.decimal_digits, &nullable);
+				if (!TIODBC_SUCCESS_CODE(rc))
+				{
+					m_columns.clear();
+					return false;
+				}
+
+				// Again if name did not fit
+				if (name_len < (SQLSMALLINT)name.size())
+					break;
+				name.resize(name_len + 1);
+			}
+			col.name = (const TCHAR *)&name[0];
+			col.nullable = (nullable != SQL_NO_NULLS);
+		}
+
+		// Hash table of names, at most half full
+		size_t slots = 4;
+		while(slots < m_columns.size() * 2)
+			slots *= 2;
+		m_name_index.assign(slots, 0);
+		for(int i = 0;i < total_cols;i++)
+		{
+			size_t pos = __hash_name(m_columns[i].name) & (slots - 1);
+			while(m_name_index[pos] != 0)
+				pos = (pos + 1) & (slots - 1);
+			m_name_index[pos] = i + 1;
+		}
+
+		b_described = true;
+		return true;
+	}
+
+	// Find a column of the result set by name
+	int statement::find_column(const _tstring & _name, bool _case_sensitive) const
+	{
+		if (!describe() || m_columns.empty())
+			return 0;
+
+		// Columns with the same folded name are probed in column order
+		size_t mask = m_name_index.size() - 1;
+		for(size_t pos = __hash_name(_name) & mask;m_name_index[pos] != 0;pos = (pos + 1) & mask)
+		{
+			const _tstring & name = m_columns[m_name_index[pos] - 1].name;
+			if (_case_sensitive?(name == _name):__same_name(name, _name))
+				return m_name_index[pos];
+		}
+		return 0;
+	}
+
+	// Get a field by column name
+	const field_impl statement::field(const _tstring & _name) const
+	{
+		return field_impl(this, find_column(_name));
+	}
+
+	// Get the description of all columns of the result set
+	const std::vector<column_descriptor> & statement::columns() const
+	{
+		describe();
+		return m_columns;
+	}
+
+	// Get the name of a column
+	_tstring statement::column_name(int _num) const
+	{
+		if (!describe() || (_num < 1) || (_num > (int)m_columns.size()))
+			return _tstring();
+		return m_columns[_num - 1].name;
+	}
+
+	// Get the SQL type of a column
+	SQLSMALLINT statement::column_type(int _num) const
+	{
+		if (!describe() || (_num < 1) || (_num > (int)m_columns.size()))
+			return SQL_UNKNOWN_TYPE;
+		return m_columns[_num - 1].sql_type;
+	}
+
+	// Get the size of a column
+	SQLULEN statement::column_size(int _num) const
+	{
+		if (!describe() || (_num < 1) || (_num > (int)m_columns.size()))
+			return 0;
+		return m_columns[_num - 1].size;
+	}
+
+	// Get last error description
+	_tstring statement::last_error()
+	{
+		_tstring error, state;
+		
+		// Saved by a failed operation
+		if (!saved_error_state.empty() && (saved_error_serial == fetch_serial))
+			return saved_error;
+
+		// The prefetch thread may be using the handle
+		if (p_prefetch)
+			return error;
+
+		// Get error message
+		__get_error(SQL_HANDLE_STMT, stmt_h, error, state);
+
+		return error;
+	}
+
+	// Keep the diagnostics of a failed operation
+	void statement::save_error()
+	{
+		__get_error(SQL_HANDLE_STMT, stmt_h, saved_error, saved_error_state);
+		saved_error_serial = fetch_serial;
+	}
+
+	// Get last error code
+	_tstring statement::last_error_status_code()
+	{
+		_tstring error, state;
+		
+		if (!saved_error_state.empty() && (saved_error_serial == fetch_serial))
+			return saved_error_state;
+		if (p_prefetch)
+			return state;
+
+		__get_error(SQL_HANDLE_STMT, stmt_h, error, state);
+
+		return state;
+	}
+
+	// Handle a parameter
+	param_impl & statement::param(int _num)
+	{
+		// Add a new if there isn't one
+		if (0 == m_params.count(_num))
+			m_params[_num] = new param_impl(this, _num);
+		
+		return *m_params[_num];
+	}
+
+	// Reset parameters (unbind all parameters
+	void statement::reset_parameters()
+	{
+		if (!is_open())
+			return;
+		stop_prefetch();
+
+		TIODBC_STATS_CALL(this, free_stmt);
+		SQLFreeStmt(stmt_h, SQL_RESET_PARAMS);
+		for(param_it it = m_params.begin();it != m_params.end();it++)
+			it->second->b_bound = false;
+		m_param_slots.clear();
+		m_param_texts.clear();
+	}
+
+	// Execute a prepared statement for a batch of parameter rows
+	bool statement::execute_batch(unsigned long _rows)
+	{
+		RETCODE rc;
+		m_param_status.assign(_rows, (SQLUSMALLINT)SQL_PARAM_UNUSED);
+		params_processed = 0;
+
+		if (!is_open() || (_rows == 0))
+			return false;
+		stop_prefetch();
+
+		// All parameters must be arrays big enough
+		for(param_it it = m_params.begin();it != m_params.end();it++)
+			if (it->second->_int_array_rows < _rows)
+				return false;
+		for(size_t i = 0;i < m_param_slots.size();i++)
+			if (m_param_slots[i].c_type != 0)
+				return false;
+
+		TIODBC_STATS_TIMER(this, execute_ns);
+		TIODBC_STATS_ADD(this, executions, 1);
+		unsigned long long query_start = start_query_timer();
+		TIODBC_STATS_CALLS(this, stmt_attr, 4);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_STATUS_PTR, &m_param_status[0], 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMS_PROCESSED_PTR, &params_processed, 0);
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)(SQLULEN)_rows, 0);
+		if (TIODBC_SUCCESS_CODE(rc))
+		{
+			TIODBC_STATS_CALL(this, execute);
+			rc = SQLExecute(stmt_h);
+			record_query_execution(query_start, TIODBC_SUCCESS_CODE(rc));
+		}
+
+		// Back to single parameter set
+		TIODBC_STATS_CALLS(this, stmt_attr, 3);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_STATUS_PTR, NULL, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMS_PROCESSED_PTR, NULL, 0);
+
+		return TIODBC_SUCCESS_CODE(rc);
+	}
+
+	// Get the status of every row of the last batch
+	const std::vector<SQLUSMALLINT> & statement::batch_status() const
+	{
+		return m_param_status;
+	}
+
+	// Get the number of rows processed by the last batch
+	unsigned long statement::batch_processed() const
+	{
+		return (unsigned long)params_processed;
+	}
+
+	// Start an asynchronous operation
+	async_result statement::start_async(int _op)
+	{
+		// Without driver support it runs synchronously
+		TIODBC_STATS_CALL(this, stmt_attr);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_ON, 0);
+		async_op = _op;
+		saved_error_state.clear();
+		async_query_start = (_op == async_fetch)?0:start_query_timer();
+		poll_async();
+		return async_result(this);
+	}
+
+	// Call the function of the asynchronous operation again
+	bool statement::poll_async()
+	{
+		RETCODE rc;
+		switch(async_op)
+		{
+		case async_execute:
+			TIODBC_STATS_CALL(this, execute);
+			rc = SQLExecute(stmt_h);
+			break;
+		case async_execute_direct:
+			TIODBC_STATS_CALL(this, exec_direct);
+			rc = SQLExecDirect(stmt_h, (SQLTCHAR *)async_query.c_str(), SQL_NTS);
+			break;
+		case async_fetch:
+			TIODBC_STATS_CALL(this, fetch);
+			rc = SQLFetch(stmt_h);
+			break;
+		default:
+			return true;
+		}
+		if (rc == SQL_STILL_EXECUTING)
+			return false;
+
+		// Streamed parameters cannot be sent asynchronously
+		if (rc == SQL_NEED_DATA)
+		{
+			TIODBC_STATS_CALL(this, cancel);
+			SQLCancel(stmt_h);
+			rc = SQL_ERROR;
+		}
+
+		// Keep the error, going back to synchronous mode clears it
+		bool b_ok = TIODBC_SUCCESS_CODE(rc);
+		if (!b_ok && (rc != SQL_NO_DATA))
+			save_error();
+		TIODBC_STATS_CALL(this, stmt_attr);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, 0);
+
+		if ((async_op == async_fetch) && (rc == SQL_NO_DATA))
+			complete_query_fetch();
+
+		if (async_op != async_fetch)
+		{
+			record_query_execution(async_query_start, b_ok);
+
+			// Prepare block cursor
+			if (b_ok && (rowset_rows > 1))
+				bind_rowset();
+		}
+		else if (b_rowset_bound)
+		{	// First row of the new rowset
+			if (!b_ok)
+				rows_fetched = 0;
+			else
+			{
+				rowset_pos = 0;
+				while((rowset_pos < rows_fetched) && !__row_fetched(m_row_status[rowset_pos]))
+					rowset_pos++;
+				if (rowset_pos >= rows_fetched)
+					b_ok = fetch_next();
+			}
+		}
+
+		complete_async(b_ok);
+		return true;
+	}
+
+	// Complete the asynchronous operation
+	void statement::complete_async(bool _result)
+	{
+		async_op = async_none;
+		b_async_result = _result;
+#ifdef TIODBC_HAS_CXX11
+		for(size_t i = 0;i < m_async_promises.size();i++)
+			m_async_promises[i].set_value(_result);
+		m_async_promises.clear();
+#endif
+	}
+
+	// Execute directly an sql query, asynchronously
+	async_result statement::execute_direct_async(connection & _conn, const _tstring & _query)
+	{
+		// Close previous
+		close();
+
+		// open a new one
+		if (!open(_conn))
+		{
+			complete_async(false);
+			return async_result(this);
+		}
+
+		async_query = _query;
+		profile_query(_query, false);
+		return start_async(async_execute_direct);
+	}
+
+	// Execute a prepared statement, asynchronously
+	async_result statement::execute_async()
+	{
+		if (async_op != async_none)
+			return async_result();
+		if (!is_open())
+		{
+			complete_async(false);
+			return async_result(this);
+		}
+		stop_prefetch();
+
+		fetch_serial++;
+		b_described = false;
+		return start_async(async_execute);
+	}
+
+	// Fetch next result row, asynchronously
+	async_result statement::fetch_next_async()
+	{
+		if (async_op != async_none)
+			return async_result();
+		if (!is_open())
+		{
+			complete_async(false);
+			return async_result(this);
+		}
+
+		if (p_prefetch || b_prefetch_ready)
+		{	// Rowsets are fetched in background
+			complete_async(fetch_next());
+			return async_result(this);
+		}
+
+		fetch_serial++;
+		if (b_rowset_bound)
+		{	// Move inside the current rowset
+			while(++rowset_pos < rows_fetched)
+				if (__row_fetched(m_row_status[rowset_pos]))
+				{
+					complete_async(true);
+					return async_result(this);
+				}
+		}
+		return start_async(async_fetch);
+	}
+
+	// Look up the profile of a query in the registry of connection
+	void statement::profile_query(const _tstring & _sql, bool _prepared)
+	{
+#ifdef TIODBC_HAS_CXX11
+		query_registry * registry = p_conn?p_conn->p_queries:NULL;
+		if (!registry)
+		{
+			p_query = NULL;
+			return;
+		}
+
+		// Same query as last time needs no normalization
+		if (!p_query || (p_query->p_registry != registry) || (profiled_sql != _sql))
+		{
+			p_query = registry->profile(_sql);
+			profiled_sql = _sql;
+		}
+		if (p_query && _prepared)
+			p_query->n_prepares++;
+#else
+		(void)_sql;
+		(void)_prepared;
+		p_query = NULL;
+#endif
+	}
+
+	// Start timing an execution of the profiled query
+	unsigned long long statement::start_query_timer() const
+	{
+#ifdef TIODBC_HAS_CXX11
+		if (p_query)
+			return __monotonic_ns();
+#endif
+		return 0;
+	}
+
+	// Record an execution of the profiled query and start timing its fetch
+	void statement::record_query_execution(unsigned long long _start, bool _success)
+	{
+		query_fetch_start = 0;
+#ifdef TIODBC_HAS_CXX11
+		if (!p_query || !_start)
+			return;
+		if (!_success)
+		{
+			p_query->n_failures++;
+			return;
+		}
+
+		unsigned long long now = __monotonic_ns();
+		p_query->m_execute.record(now - _start);
+		query_fetch_start = now;
+#else
+		(void)_start;
+		(void)_success;
+#endif
+	}
+
+	// Record fetch-to-completion latency when the result set is exhausted
+	void statement::complete_query_fetch()
+	{
+#ifdef TIODBC_HAS_CXX11
+		if (p_query && query_fetch_start)
+			p_query->m_fetch.record(__monotonic_ns() - query_fetch_start);
+#endif
+		query_fetch_start = 0;
+	}
+
+	// Get a snapshot of the counters
+	odbc_stats statement::stats() const
+	{
+		return m_stats;
+	}
+
+	// Set the counters to zero
+	void statement::reset_stats()
+	{
+		m_stats.reset();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// TRANSACTION IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Start a transaction on a connection
+	transaction::transaction(connection & _conn)
+		:p_conn(&_conn),
+		b_active(false),
+		b_autocommit(_conn.autocommit())
+	{
+		b_active = !b_autocommit || _conn.set_autocommit(false);
+	}
+
+	// Destructor
+	transaction::~transaction()
+	{
+		if (b_active)
+			rollback();
+		if (b_autocommit)
+			p_conn->set_autocommit(true);
+	}
+
+	// Check if transaction has started and not ended yet
+	bool transaction::active() const
+	{
+		return b_active;
+	}
+
+	// Commit and end the transaction
+	bool transaction::commit()
+	{
+		if (!b_active)
+			return false;
+
+		// A failed commit stays open until it is rolled back
+		b_active = !p_conn->commit();
+		return !b_active;
+	}
+
+	// Roll back and end the transaction
+	bool transaction::rollback()
+	{
+		if (!b_active)
+			return false;
+		b_active = false;
+		return p_conn->rollback();
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// BATCH WRITER IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Construct on a prepared statement
+	batch_writer::batch_writer(statement & _stmt, unsigned long _commit_rows, unsigned long _commit_ms)
+		:p_stmt(&_stmt),
+		p_conn(_stmt.p_conn),
+		commit_rows(_commit_rows),
+		commit_ns((unsigned long long)_commit_ms * 1000000ULL),
+		batch_start(0),
+		pending_rows(0),
+		committed_rows(0),
+		n_commits(0),
+		b_autocommit(false),
+		b_ready(false)
+	{
+		if (!_stmt.is_open() || !p_conn)
+			return;
+		b_autocommit = p_conn->autocommit();
+		b_ready = !b_autocommit || p_conn->set_autocommit(false);
+	}
+
+	// Destructor
+	batch_writer::~batch_writer()
+	{
+		if (!b_ready)
+			return;
+
+		// Restoring autocommit would commit whatever is left, e.g. after a failed execution
+		rollback();
+		if (b_autocommit)
+			p_conn->set_autocommit(true);
+	}
+
+	// Check if the writer can be used
+	bool batch_writer::ready() const
+	{
+		return b_ready;
+	}
+
+	// Count written rows and commit if a limit was reached
+	bool batch_writer::add_rows(unsigned long _rows)
+	{
+		if (!pending_rows && commit_ns)
+			batch_start = __monotonic_ns();
+		pending_rows += _rows;
+
+		if ((commit_rows && (pending_rows >= commit_rows))
+			|| (commit_ns && (__monotonic_ns() - batch_start >= commit_ns)))
+			return commit();
+		return true;
+	}
+
+	// Execute the statement with its current parameters
+	bool batch_writer::execute()
+	{
+		if (!b_ready || !p_stmt->execute())
+			return false;
+		return add_rows(1);
+	}
+
+	// Execute the statement for a batch of parameter rows
+	bool batch_writer::execute_batch(unsigned long _rows)
+	{
+		if (!b_ready || !p_stmt->execute_batch(_rows))
+			return false;
+		return add_rows(_rows);
+	}
+
+	// Commit the pending rows
+	bool batch_writer::commit()
+	{
+		if (!b_ready)
+			return false;
+		if (!pending_rows)
+			return true;
+		if (!p_conn->commit())
+			return false;
+		committed_rows += pending_rows;
+		pending_rows = 0;
+		n_commits++;
+		return true;
+	}
+
+	// Roll back the pending rows
+	bool batch_writer::rollback()
+	{
+		if (!b_ready)
+			return false;
+		pending_rows = 0;
+		return p_conn->rollback();
+	}
+
+	// Get the number of rows written but not committed yet
+	unsigned long batch_writer::pending() const
+	{
+		return pending_rows;
+	}
+
+	// Get the number of rows committed
+	unsigned long long batch_writer::committed() const
+	{
+		return committed_rows;
+	}
+
+	// Get the number of commits done
+	unsigned long batch_writer::commits() const
+	{
+		return n_commits;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// ASYNC RESULT IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Not direct constructible
+	async_result::async_result(statement * _stmt)
+		:p_stmt(_stmt)
+	{
+	}
+
+	// Construct an invalid result
+	async_result::async_result()
+		:p_stmt(NULL)
+	{
+	}
+
+	// Check if it refers to a statement
+	bool async_result::valid() const
+	{
+		return p_stmt != NULL;
+	}
+
+	// Poll the driver once
+	bool async_result::poll()
+	{
+		if (!p_stmt)
+			return true;
+		return p_stmt->poll_async();
+	}
+
+	// Check if the operation is complete
+	bool async_result::ready() const
+	{
+		return !p_stmt || (p_stmt->async_op == statement::async_none);
+	}
+
+	// Get the result of the complete operation
+	bool async_result::result() const
+	{
+		return ready() && p_stmt && p_stmt->b_async_result;
+	}
+
+	// Cancel the operation
+	void async_result::cancel()
+	{
+		if (ready())
+			return;
+		TIODBC_STATS_CALL(p_stmt, cancel);
+		SQLCancel(p_stmt->stmt_h);
+		TIODBC_STATS_CALL(p_stmt, stmt_attr);
+		SQLSetStmtAttr(p_stmt->stmt_h, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, 0);
+		p_stmt->complete_async(false);
+	}
+
+#ifdef TIODBC_HAS_CXX11
+	// Poll until the operation is complete or timeout
+	bool async_result::wait(unsigned long _timeout_ms)
+	{
+		std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout_ms);
+		std::chrono::microseconds pause(16);
+
+		while(!poll())
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= deadline)
+				return false;
+			if (now + pause > deadline)
+				pause = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+			std::this_thread::sleep_for(pause);
+			if (pause < std::chrono::milliseconds(10))
+				pause *= 2;
+		}
+		return true;
+	}
+
+	// Get a future that receives result() when the operation completes
+	std::future<bool> async_result::get_future()
+	{
+		std::promise<bool> promise;
+		std::future<bool> future = promise.get_future();
+		if (ready())
+			promise.set_value(result());
+		else
+			p_stmt->m_async_promises.push_back(std::move(promise));
+		return future;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// CONNECTION POOL IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Construct a handle of a borrowed connection
+	connection_pool::handle::handle(connection_pool * _pool, connection * _conn)
+		:p_pool(_pool),
+		p_conn(_conn)
+	{}
+
+	// Construct an invalid handle
+	connection_pool::handle::handle()
+		:p_pool(NULL),
+		p_conn(NULL)
+	{}
+
+	// Move constructor
+	connection_pool::handle::handle(handle && r)
+		:p_pool(r.p_pool),
+		p_conn(r.p_conn)
+	{
+		r.p_pool = NULL;
+		r.p_conn = NULL;
+	}
+
+	// Move operator
+	connection_pool::handle & connection_pool::handle::operator=(handle && r)
+	{
+		if (this != &r)
+		{
+			release();
+			p_pool = r.p_pool;
+			p_conn = r.p_conn;
+			r.p_pool = NULL;
+			r.p_conn = NULL;
+		}
+		return *this;
+	}
+
+	// Destructor
+	connection_pool::handle::~handle()
+	{
+		release();
+	}
+
+	// Return connection to the pool
+	void connection_pool::handle::release()
+	{
+		if (p_conn)
+			p_pool->checkin(p_conn);
+		p_pool = NULL;
+		p_conn = NULL;
+	}
+
+	// Construct and open minimum connections
+	connection_pool::connection_pool(const _tstring & _dsn,
+		const _tstring & _user,
+		const _tstring & _pass,
+		size_t _min_size,
+		size_t _max_size)
+		:m_dsn(_dsn),
+		m_user(_user),
+		m_pass(_pass),
+		min_size(_min_size),
+		max_size((_max_size > 0)?_max_size:1),
+		total_size(0),
+		idle_timeout(0),
+		n_checkouts(0),
+		n_waits(0),
+		n_timeouts(0),
+		n_connects(0),
+		n_connect_failures(0),
+		n_validation_failures(0),
+		n_evictions(0),
+		n_wait_us(0)
+	{
+		if (min_size > max_size)
+			min_size = max_size;
+
+		for(size_t i = 0;i < min_size;i++)
+		{
+			connection * p_conn = new connection(m_dsn, m_user, m_pass);
+			if (!p_conn->connected())
+			{
+				m_last_error = p_conn->last_error();
+				n_connect_failures++;
+				delete p_conn;
+				break;
+			}
+			n_connects++;
+			idle_connection idle = { p_conn, std::chrono::steady_clock::now() };
+			m_idle.push_back(idle);
+			total_size++;
+		}
+	}
+
+	// Destructor
+	connection_pool::~connection_pool()
+	{
+		for(size_t i = 0;i < m_idle.size();i++)
+			delete m_idle[i].p_conn;
+		m_idle.clear();
+	}
+
+	// Remove expired idle connections
+	void connection_pool::collect_expired(std::vector<connection *> & _expired)
+	{
+		if (idle_timeout.count() == 0)
+			return;
+
+		// Oldest connections are at the front
+		std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now() - idle_timeout;
+		size_t n = 0;
+		while((n < m_idle.size())
+			&& (m_idle[n].since < limit)
+			&& (total_size - n > min_size))
+		{
+			_expired.push_back(m_idle[n].p_conn);
+			n++;
+		}
+		m_idle.erase(m_idle.begin(), m_idle.begin() + n);
+		n_evictions += (unsigned long)n;
+	}
+
+	// Close connections and update the pool size
+	void connection_pool::destroy(std::vector<connection *> & _conns)
+	{
+		if (_conns.empty())
+			return;
+
+		for(size_t i = 0;i < _conns.size();i++)
+			delete _conns[i];
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			total_size -= _conns.size();
+		}
+		m_returned.notify_all();
+		_conns.clear();
+	}
+
+	// Borrow a connection
+	connection_pool::handle connection_pool::checkout(unsigned long _timeout_ms)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point deadline = start + std::chrono::milliseconds(_timeout_ms);
+		std::vector<connection *> discarded;
+		bool b_waited = false;
+
+		while(true)
+		{
+			connection * p_conn = NULL;
+			bool b_new = false;
+			validator_type validator;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				collect_expired(discarded);
+				while(m_idle.empty() && (total_size - discarded.size() >= max_size))
+				{
+					b_waited = true;
+					if (m_returned.wait_until(lock, deadline) == std::cv_status::timeout
+						&& m_idle.empty()
+						&& (total_size - discarded.size() >= max_size))
+					{
+						lock.unlock();
+						destroy(discarded);
+						n_waits++;
+						n_timeouts++;
+						n_wait_us += std::chrono::duration_cast<std::chrono::microseconds>(
+							std::chrono::steady_clock::now() - start).count();
+						return handle();
+					}
+				}
+
+				if (!m_idle.empty())
+				{	// Most recently used, validated outside the lock
+					p_conn = m_idle.back().p_conn;
+					m_idle.pop_back();
+					validator = m_validator;
+				}
+				else
+				{	// Reserve a slot for a new one
+					total_size++;
+					b_new = true;
+				}
+			}
+			destroy(discarded);
+
+			if (b_new)
+			{
+				p_conn = new connection(m_dsn, m_user, m_pass);
+				if (!p_conn->connected())
+				{
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_last_error = p_conn->last_error();
+					}
+					n_connect_failures++;
+					discarded.push_back(p_conn);
+					destroy(discarded);
+					return handle();
+				}
+				n_connects++;
+			}
+			else if (!p_conn->connected() || (validator && !validator(*p_conn)))
+			{	// Broken, try another one
+				n_validation_failures++;
+				discarded.push_back(p_conn);
+				destroy(discarded);
+				continue;
+			}
+
+			n_checkouts++;
+			if (b_waited)
+			{
+				n_waits++;
+				n_wait_us += std::chrono::duration_cast<std::chrono::microseconds>(
+					std::chrono::steady_clock::now() - start).count();
+			}
+			return handle(this, p_conn);
+		}
+	}
+
+	// Return a connection to the pool
+	void connection_pool::checkin(connection * _conn)
+	{
+		// Roll back a transaction left open by the borrower
+		bool b_reusable = _conn->connected();
+		if (b_reusable && !_conn->autocommit())
+			b_reusable = _conn->rollback() && _conn->set_autocommit(true);
+
+		std::vector<connection *> discarded;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (b_reusable)
+			{
+				idle_connection idle = { _conn, std::chrono::steady_clock::now() };
+				m_idle.push_back(idle);
+			}
+			else
+				discarded.push_back(_conn);
+			collect_expired(discarded);
+		}
+		m_returned.notify_one();
+		destroy(discarded);
+	}
+
+	// Set the validation hook
+	void connection_pool::set_validator(const validator_type & _validator)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_validator = _validator;
+	}
+
+	// Set idle timeout
+	void connection_pool::set_idle_timeout(unsigned long _idle_ms)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		idle_timeout = std::chrono::milliseconds(_idle_ms);
+	}
+
+	// Close expired idle connections
+	size_t connection_pool::evict_idle()
+	{
+		std::vector<connection *> expired;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			collect_expired(expired);
+		}
+		size_t n = expired.size();
+		destroy(expired);
+		return n;
+	}
+
+	// Get a snapshot of the pool counters
+	connection_pool::statistics connection_pool::stats() const
+	{
+		statistics st;
+		st.checkouts = n_checkouts;
+		st.waits = n_waits;
+		st.timeouts = n_timeouts;
+		st.connects = n_connects;
+		st.connect_failures = n_connect_failures;
+		st.validation_failures = n_validation_failures;
+		st.evictions = n_evictions;
+		st.wait_us = n_wait_us;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		st.idle = m_idle.size();
+		st.total = total_size;
+		return st;
+	}
+
+	// Get the error of the last connection that failed to open
+	_tstring connection_pool::last_error() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_last_error;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// QUERY REGISTRY IMPLEMENTATION
 	///////////////////////////////////////////////////////////////////////////////////
-	// STATEMENT IMPLEMENTATION
-	///////////////////////////////////////////////////////////////////////////////////
 
-	// Default constructor
-	statement::statement()
-		:stmt_h(NULL),
-		b_open(false)
+	//! @cond INTERNAL_FUNCTIONS
+
+	// Check if a character is part of a word of a query
+	bool __is_query_word(TCHAR _c)
+	{
+		return ((_c >= 'a') && (_c <= 'z'))
+			|| ((_c >= 'A') && (_c <= 'Z'))
+			|| ((_c >= '0') && (_c <= '9'))
+			|| (_c == '_') || (_c == '$') || (_c == '@') || (_c == '#')
+			|| (((unsigned long)_c & ~0x7FUL) != 0);	// Not ASCII
+	}
+
+	// Check if whitespace must be kept in front of or after a character
+	bool __is_query_spaced(TCHAR _c)
+	{
+		return __is_query_word(_c)
+			|| (_c == '?') || (_c == '\'') || (_c == '"') || (_c == '`') || (_c == '[') || (_c == ']');
+	}
+
+	// Check if a character is a decimal digit
+	bool __is_query_digit(TCHAR _c)
+	{
+		return (_c >= '0') && (_c <= '9');
+	}
+
+	// 64-bit FNV-1a hash of a fingerprint
+	unsigned long long __fingerprint_hash(const _tstring & _fingerprint)
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		for(size_t i = 0;i < _fingerprint.size();i++)
+		{
+			hash ^= (unsigned long long)_fingerprint[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// Append a string to JSON output, escaped and quoted
+	void __json_append(std::string & _out, const _tstring & _text)
+	{
+		static const char hex[] = "0123456789abcdef";
+		_out += '"';
+		for(size_t i = 0;i < _text.size();i++)
+		{
+			unsigned long c = (unsigned long)_text[i];
+			if (sizeof(TCHAR) == 1)
+				c &= 0xFF;
+			if ((c == '"') || (c == '\\'))
+			{
+				_out += '\\';
+				_out += (char)c;
+			}
+			else if ((c < 0x20) || ((sizeof(TCHAR) > 1) && (c > 0x7E)))
+			{	// Control characters, and wide characters as UTF-16
+				unsigned long units[2] = {c, 0};
+				int n_units = 1;
+				if (c > 0xFFFF)
+				{
+					units[0] = 0xD800 + ((c - 0x10000) >> 10);
+					units[1] = 0xDC00 + ((c - 0x10000) & 0x3FF);
+					n_units = 2;
+				}
+				for(int u = 0;u < n_units;u++)
+				{
+					_out += "\\u";
+					for(int shift = 12;shift >= 0;shift -= 4)
+						_out += hex[(units[u] >> shift) & 0xF];
+				}
+			}
+			else
+				_out += (char)c;	// Narrow text is passed as it is (UTF-8)
+		}
+		_out += '"';
+	}
+
+	// Append a histogram to JSON output
+	void __json_append(std::string & _out, const latency_histogram & _histogram)
+	{
+		std::ostringstream str;
+		str << "{\"count\": " << _histogram.count()
+			<< ", \"mean_ns\": " << _histogram.mean_ns()
+			<< ", \"p50_ns\": " << _histogram.percentile_ns(0.5)
+			<< ", \"p99_ns\": " << _histogram.percentile_ns(0.99)
+			<< ", \"p999_ns\": " << _histogram.percentile_ns(0.999)
+			<< ", \"max_ns\": " << _histogram.max_ns() << "}";
+		_out += str.str();
+	}
+
+	//! @endcond
+
+	// Construct an empty histogram
+	latency_histogram::latency_histogram()
+	{
+		reset();
+	}
+
+	// Add a latency in nanoseconds
+	void latency_histogram::record(unsigned long long _ns)
 	{
+		m_buckets[bucket_of(_ns)].fetch_add(1, std::memory_order_relaxed);
+		n_count.fetch_add(1, std::memory_order_relaxed);
+		n_sum_ns.fetch_add(_ns, std::memory_order_relaxed);
+
+		unsigned long long prev = n_max_ns.load(std::memory_order_relaxed);
+		while((prev < _ns) && !n_max_ns.compare_exchange_weak(prev, _ns, std::memory_order_relaxed))
+			;
 	}
 
-	// Construct and initialize
-	statement::statement(connection & _conn, const _tstring & _stmt)
-		:stmt_h(NULL),
-		b_open(false)
+	// Get the number of recorded latencies
+	unsigned long long latency_histogram::count() const
 	{
-		prepare(_conn, _stmt);
+		return n_count.load(std::memory_order_relaxed);
+	}
+
+	// Get the mean latency
+	unsigned long long latency_histogram::mean_ns() const
+	{
+		unsigned long long n = count();
+		return n?n_sum_ns.load(std::memory_order_relaxed) / n:0;
+	}
+
+	// Get the maximum latency
+	unsigned long long latency_histogram::max_ns() const
+	{
+		return n_max_ns.load(std::memory_order_relaxed);
+	}
+
+	// Get a percentile of latencies
+	unsigned long long latency_histogram::percentile_ns(double _fraction) const
+	{
+		// Work on a snapshot, so that rank is consistent with buckets
+		unsigned long long snapshot[bucket_count];
+		unsigned long long total = 0;
+		for(int i = 0;i < bucket_count;i++)
+		{
+			snapshot[i] = m_buckets[i].load(std::memory_order_relaxed);
+			total += snapshot[i];
+		}
+		if (total == 0)
+			return 0;
+
+		if (_fraction < 0)
+			_fraction = 0;
+		if (_fraction > 1)
+			_fraction = 1;
+		unsigned long long rank = (unsigned long long)(_fraction * (double)total + 0.999999);
+		if (rank < 1)
+			rank = 1;
+		if (rank > total)
+			rank = total;
+
+		unsigned long long seen = 0;
+		for(int i = 0;i < bucket_count;i++)
+		{
+			seen += snapshot[i];
+			if (seen < rank)
+				continue;
+
+			// Middle of bucket, but never above the maximum
+			unsigned long long value = bucket_lower(i) + bucket_width(i) / 2;
+			unsigned long long highest = max_ns();
+			return ((highest != 0) && (value > highest))?highest:value;
+		}
+		return max_ns();
+	}
+
+	// Set everything to zero
+	void latency_histogram::reset()
+	{
+		for(int i = 0;i < bucket_count;i++)
+			m_buckets[i].store(0, std::memory_order_relaxed);
+		n_count.store(0, std::memory_order_relaxed);
+		n_sum_ns.store(0, std::memory_order_relaxed);
+		n_max_ns.store(0, std::memory_order_relaxed);
+	}
+
+	// Get the bucket of a latency
+	int latency_histogram::bucket_of(unsigned long long _ns)
+	{
+		if (_ns < sub_buckets)
+			return (int)_ns;
+
+		// Position of highest bit
+		int high = 0;
+		unsigned long long v = _ns;
+		if (v >> 32)	{	v >>= 32;	high += 32;	}
+		if (v >> 16)	{	v >>= 16;	high += 16;	}
+		if (v >> 8)		{	v >>= 8;	high += 8;	}
+		if (v >> 4)		{	v >>= 4;	high += 4;	}
+		if (v >> 2)		{	v >>= 2;	high += 2;	}
+		if (v >> 1)		{	high += 1;	}
+
+		// 3 bits below the highest one choose the bucket inside the power of two
+		return (high - 2) * sub_buckets + (int)((_ns >> (high - 3)) & (sub_buckets - 1));
+	}
+
+	// Get the smallest latency of a bucket
+	unsigned long long latency_histogram::bucket_lower(int _bucket)
+	{
+		if (_bucket < sub_buckets)
+			return (unsigned long long)_bucket;
+		int high = _bucket / sub_buckets + 2;
+		return (unsigned long long)(sub_buckets + _bucket % sub_buckets) << (high - 3);
+	}
+
+	// Get the width of a bucket
+	unsigned long long latency_histogram::bucket_width(int _bucket)
+	{
+		if (_bucket < sub_buckets)
+			return 1;
+		return 1ULL << (_bucket / sub_buckets - 1);
+	}
+
+	// Construct a profile
+	query_profile::query_profile(const query_registry * _registry, unsigned long long _id, const _tstring & _fingerprint)
+		:p_registry(_registry),
+		m_id(_id),
+		m_fingerprint(_fingerprint),
+		n_prepares(0),
+		n_failures(0)
+	{}
+
+	// Set everything to zero
+	void query_profile::reset()
+	{
+		n_prepares = 0;
+		n_failures = 0;
+		m_execute.reset();
+		m_fetch.reset();
+	}
+
+	// Construct a registry
+	query_registry::query_registry(size_t _capacity)
+		:m_mask(0),
+		n_dropped(0),
+		b_dumping(false),
+		dump_interval(0)
+	{
+		size_t slots = 16;
+		while(slots < _capacity)
+			slots *= 2;
+		m_slots.reset(new std::atomic<query_profile *>[slots]);
+		for(size_t i = 0;i < slots;i++)
+			m_slots[i].store(NULL, std::memory_order_relaxed);
+		m_mask = slots - 1;
 	}
 
 	// Destructor
-	statement::~statement()
+	query_registry::~query_registry()
 	{
-		close();
+		stop_dump();
+		for(size_t i = 0;i <= m_mask;i++)
+			delete m_slots[i].load(std::memory_order_relaxed);
 	}
 
-	// Used to create a statement (used automatically by the other functions)
-	bool statement::open(connection & _conn)
+	// Normalize the text of a query into its fingerprint
+	_tstring query_registry::normalize(const _tstring & _sql)
 	{
-		RETCODE rc;
-		// close previous one
-		close();
+		_tstring out;
+		out.reserve(_sql.size());
 
-		// Allocate statement
-		rc = SQLAllocHandle(SQL_HANDLE_STMT, _conn.native_dbc_handle(), &stmt_h);
-		if (!TIODBC_SUCCESS_CODE(rc))
+		bool b_space = false;	// Whitespace or comment since last token
+		size_t i = 0, n = _sql.size();
+		while(i < n)
 		{
-			stmt_h = NULL;
-			b_open = false;
-			return false;
+			TCHAR c = _sql[i];
+			TCHAR next = (i + 1 < n)?_sql[i + 1]:0;
+
+			// Whitespace and comments
+			if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '\f') || (c == '\v'))
+			{
+				b_space = true;
+				i++;
+				continue;
+			}
+			if ((c == '-') && (next == '-'))
+			{
+				while((i < n) && (_sql[i] != '\n'))
+					i++;
+				b_space = true;
+				continue;
+			}
+			if ((c == '/') && (next == '*'))
+			{
+				for(i += 2;(i < n) && !((_sql[i] == '*') && (i + 1 < n) && (_sql[i + 1] == '/'));i++)
+					;
+				i = (i + 2 < n)?i + 2:n;
+				b_space = true;
+				continue;
+			}
+
+			// Keep one space only between two words
+			bool b_word_before = !b_space && !out.empty() && __is_query_word(out[out.size() - 1]);
+			if (b_space && !out.empty() && __is_query_spaced(out[out.size() - 1]) && __is_query_spaced(c))
+				out += ' ';
+			b_space = false;
+
+			// Prefix of a string literal (N'', X'', B'')
+			if (((c == 'N') || (c == 'n') || (c == 'X') || (c == 'x') || (c == 'B') || (c == 'b'))
+				&& (next == '\'') && !b_word_before)
+			{
+				i++;
+				continue;
+			}
+
+			if (c == '\'')
+			{	// String literal, quotes inside are doubled
+				for(i++;i < n;i++)
+				{
+					if (_sql[i] != '\'')
+						continue;
+					if ((i + 1 < n) && (_sql[i + 1] == '\''))
+						i++;
+					else
+						break;
+				}
+				i++;
+				out += '?';
+				continue;
+			}
+
+			if ((c == '"') || (c == '`') || (c == '['))
+			{	// Quoted identifier, kept as it is
+				TCHAR close = (c == '[')?']':c;
+				size_t end = _sql.find(close, i + 1);
+				end = (end == _tstring::npos)?n:end + 1;
+				out.append(_sql, i, end - i);
+				i = end;
+				continue;
+			}
+
+			if (!b_word_before && (__is_query_digit(c) || ((c == '.') && __is_query_digit(next))))
+			{	// Numeric literal, with exponent
+				for(i++;i < n;i++)
+				{
+					TCHAR d = _sql[i];
+					if (__is_query_word(d) || (d == '.'))
+						continue;
+					if (((d == '+') || (d == '-'))
+						&& ((_sql[i - 1] == 'e') || (_sql[i - 1] == 'E'))
+						&& (i + 1 < n) && __is_query_digit(_sql[i + 1]))
+						continue;
+					break;
+				}
+				out += '?';
+				continue;
+			}
+
+			out += c;
+			i++;
 		}
+		return out;
+	}
 
-		b_open = true;
-		return true;
+	// Get the profile of a query, adding it if needed
+	query_profile * query_registry::profile(const _tstring & _sql)
+	{
+		_tstring fingerprint = normalize(_sql);
+		unsigned long long id = __fingerprint_hash(fingerprint);
+
+		// Linear probing, slots are only filled and never emptied
+		size_t pos = (size_t)id & m_mask;
+		for(size_t probes = 0;probes <= m_mask;probes++, pos = (pos + 1) & m_mask)
+		{
+			query_profile * existing = m_slots[pos].load(std::memory_order_acquire);
+			if (!existing)
+			{
+				query_profile * added = new query_profile(this, id, fingerprint);
+				if (m_slots[pos].compare_exchange_strong(existing, added, std::memory_order_acq_rel))
+					return added;
+				delete added;	// Someone else filled the slot first
+			}
+			if ((existing->m_id == id) && (existing->m_fingerprint == fingerprint))
+				return existing;
+		}
+
+		n_dropped++;
+		return NULL;
 	}
 
-	// Check if it is an open statement
-	bool statement::is_open() const
+	// Find the profile of a query
+	const query_profile * query_registry::find(const _tstring & _sql) const
 	{
-		return b_open;
+		_tstring fingerprint = normalize(_sql);
+		unsigned long long id = __fingerprint_hash(fingerprint);
+
+		size_t pos = (size_t)id & m_mask;
+		for(size_t probes = 0;probes <= m_mask;probes++, pos = (pos + 1) & m_mask)
+		{
+			const query_profile * existing = m_slots[pos].load(std::memory_order_acquire);
+			if (!existing)
+				return NULL;
+			if ((existing->m_id == id) && (existing->m_fingerprint == fingerprint))
+				return existing;
+		}
+		return NULL;
 	}
 
-	// Close statement
-	void statement::close()
+	// Get all profiles
+	std::vector<const query_profile *> query_registry::profiles() const
 	{
-		if (is_open())
+		std::vector<const query_profile *> all;
+		for(size_t i = 0;i <= m_mask;i++)
 		{
-			// Free parameters
-			param_it it;
-			for(it = m_params.begin();it != m_params.end();it++)
-				delete it->second;
-			m_params.clear();
+			const query_profile * profile = m_slots[i].load(std::memory_order_acquire);
+			if (profile)
+				all.push_back(profile);
+		}
+		return all;
+	}
 
-			// Free result if any
-			free_results();
+	// Get the number of queries that were not profiled
+	unsigned long query_registry::dropped() const
+	{
+		return n_dropped;
+	}
 
-			// Free handle
-			SQLFreeHandle(SQL_HANDLE_STMT, stmt_h);
-			stmt_h = NULL;
+	// Set the histograms of all profiles to zero
+	void query_registry::reset()
+	{
+		for(size_t i = 0;i <= m_mask;i++)
+		{
+			query_profile * profile = m_slots[i].load(std::memory_order_acquire);
+			if (profile)
+				profile->reset();
 		}
-		b_open = false;
+		n_dropped = 0;
 	}
 
-	// Free results (aka SQLCloseCursor)
-	void statement::free_results()
+	// Write all profiles as JSON to a file
+	bool query_registry::dump(const std::string & _path) const
 	{
-		// Close cursor if we have an open connection
-		if (is_open())
-			SQLCloseCursor(stmt_h);
+		std::vector<const query_profile *> all = profiles();
+
+		std::string json = "{\n";
+		std::ostringstream header;
+		header << "  \"dropped\": " << dropped() << ",\n  \"queries\": [";
+		json += header.str();
+		for(size_t i = 0;i < all.size();i++)
+		{
+			const query_profile & profile = *all[i];
+			std::ostringstream fields;
+			fields << std::hex << profile.id() << std::dec;
+			json += (i == 0)?"\n    {\"id\": \"":",\n    {\"id\": \"";
+			json += fields.str();
+			json += "\", \"fingerprint\": ";
+			__json_append(json, profile.fingerprint());
+
+			fields.str("");
+			fields << ", \"prepares\": " << profile.prepares()
+				<< ", \"failures\": " << profile.failures() << ",\n     \"execute\": ";
+			json += fields.str();
+			__json_append(json, profile.execute_latency());
+			json += ",\n     \"fetch\": ";
+			__json_append(json, profile.fetch_latency());
+			json += "}";
+		}
+		json += "\n  ]\n}\n";
+
+		// Write aside and replace
+		std::string temp_path = _path + ".tmp";
+		{
+			std::ofstream file(temp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+			file.write(json.data(), (std::streamsize)json.size());
+			if (!file.flush())
+				return false;
+		}
+#ifdef _WIN32
+		remove(_path.c_str());
+#endif
+		return rename(temp_path.c_str(), _path.c_str()) == 0;
 	}
 
-	// Prepare statement
-	bool statement::prepare(connection & _conn, const _tstring & _stmt)
+	// Body of the dumping thread
+	void query_registry::dump_loop()
 	{
-		RETCODE rc;
-		// Close previous
-		close();
+		std::unique_lock<std::mutex> lock(m_dump_mutex);
+		while(b_dumping)
+		{
+			if (m_dump_wakeup.wait_for(lock, dump_interval, [this]() { return !b_dumping; }))
+				break;
 
-		// open a new one
-		if (!open(_conn))
-			return false;
+			std::string path = m_dump_path;
+			lock.unlock();
+			dump(path);
+			lock.lock();
+		}
+	}
 
-		// Prepare statement
-		rc = SQLPrepare(stmt_h, (SQLTCHAR *)_stmt.c_str(), SQL_NTS);
+	// Dump to a file periodically from a background thread
+	bool query_registry::start_dump(const std::string & _path, unsigned long _interval_ms)
+	{
+		stop_dump();
 
-		if (!TIODBC_SUCCESS_CODE(rc))
+		std::lock_guard<std::mutex> lock(m_dump_mutex);
+		m_dump_path = _path;
+		dump_interval = std::chrono::milliseconds(_interval_ms?_interval_ms:1);
+		b_dumping = true;
+		try
+		{
+			m_dumper = std::thread(&query_registry::dump_loop, this);
+		}
+		catch(const std::system_error &)
+		{
+			b_dumping = false;
 			return false;
-
+		}
 		return true;
 	}
 
+	// Stop the periodic dump, dumping one last time
+	void query_registry::stop_dump()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_dump_mutex);
+			if (!b_dumping)
+				return;
+			b_dumping = false;
+		}
+		m_dump_wakeup.notify_all();
+		m_dumper.join();
+		dump(m_dump_path);
+	}
 
-	// Execute direct a query
-	bool statement::execute_direct(connection & _conn, const _tstring & _query)
+	///////////////////////////////////////////////////////////////////////////////////
+	// PARALLEL READER IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	//! @cond INTERNAL_FUNCTIONS
+	// Widen an ASCII string
+	_tstring __text(const char * _text)
 	{
-		RETCODE rc;
-		// Close previous
-		close();
+		return _tstring(_text, _text + strlen(_text));
+	}
 
-		// open a new one
-		if (!open(_conn))
-			return false;
+	// Replace all occurrences of a placeholder with a number
+	void __replace_placeholder(_tstring & _text, const _tstring & _placeholder, long long _value)
+	{
+		std::basic_ostringstream<TCHAR> out;
+		out << _value;
+		_tstring value = out.str();
 
-		// Execute directly statement
-		rc = SQLExecDirect(stmt_h, (SQLTCHAR *)_query.c_str(), SQL_NTS);
-		if (!TIODBC_SUCCESS_CODE(rc))
-			return false;
+		for(size_t pos = _text.find(_placeholder);pos != _tstring::npos;pos = _text.find(_placeholder, pos + value.size()))
+			_text.replace(pos, _placeholder.size(), value);
+	}
+	//! @endcond
 
-		return true;
+	// Constructor
+	parallel_reader::parallel_reader(const _tstring & _dsn,
+		const _tstring & _user,
+		const _tstring & _pass,
+		const _tstring & _query,
+		int _partitions)
+		:m_dsn(_dsn),
+		m_user(_user),
+		m_pass(_pass),
+		m_query(_query),
+		n_partitions((_partitions > 0)?_partitions:1),
+		b_key_range(false),
+		key_first(0),
+		key_last(0),
+		rowset_rows(1024),
+		queue_size(0),
+		queue_limit(1),
+		n_running(0),
+		b_stop(false)
+	{}
+
+	// Destructor
+	parallel_reader::~parallel_reader()
+	{
+		stop();
 	}
 
-	// Execute statement
-	bool statement::execute()
+	// Split a range of keys in equal partitions
+	bool parallel_reader::set_key_range(long long _first, long long _last)
 	{
-		RETCODE rc;
-		if (!is_open())
+		// The upper bound of the last partition is _last + 1
+		if ((_last < _first) || (_last == std::numeric_limits<long long>::max()))
 			return false;
+		b_key_range = true;
+		key_first = _first;
+		key_last = _last;
+		return true;
+	}
 
-		rc = SQLExecute(stmt_h);
-		if (!TIODBC_SUCCESS_CODE(rc))
+	// Set the number of rows that are fetched at once
+	bool parallel_reader::set_rowset_size(unsigned long _rows)
+	{
+		if (_rows == 0)
 			return false;
+		rowset_rows = _rows;
 		return true;
 	}
 
-	// Fetch next
-	bool statement::fetch_next()
+	// Get the number of partitions
+	int parallel_reader::partitions() const
 	{
-		RETCODE rc;
-		if (!is_open())
+		return n_partitions;
+	}
+
+	// Get the query of a partition
+	_tstring parallel_reader::partition_query(int _partition) const
+	{
+		_tstring query = m_query;
+		__replace_placeholder(query, __text("{partitions}"), n_partitions);
+		__replace_placeholder(query, __text("{partition}"), _partition);
+
+		if (b_key_range)
+		{
+			// Spread the remainder over the first partitions
+			unsigned long long span = (unsigned long long)key_last - (unsigned long long)key_first + 1;
+			unsigned long long step = span / n_partitions;
+			unsigned long long extra = span % n_partitions;
+			unsigned long long lower = _partition * step + (((unsigned long long)_partition < extra)?_partition:extra);
+			unsigned long long upper = lower + step + (((unsigned long long)_partition < extra)?1:0);
+			__replace_placeholder(query, __text("{lower}"), (long long)((unsigned long long)key_first + lower));
+			__replace_placeholder(query, __text("{upper}"), (long long)((unsigned long long)key_first + upper));
+		}
+		return query;
+	}
+
+	// Record the error of a partition and stop the others
+	void parallel_reader::fail(int _partition, const _tstring & _error)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_last_error.empty())
+			{
+				std::basic_ostringstream<TCHAR> out;
+				out << __text("Partition ") << _partition << __text(": ") << _error;
+				m_last_error = out.str();
+			}
+		}
+		b_stop = true;
+		m_consumed.notify_all();
+	}
+
+	// Put a rowset in the merged stream, waiting for space
+	bool parallel_reader::enqueue(int _partition, columnar_result & _rows)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_consumed.wait(lock, [this]() { return b_stop || (queue_size < queue_limit); });
+		if (b_stop)
 			return false;
 
-		rc = SQLFetch(stmt_h);
-		if (TIODBC_SUCCESS_CODE(rc))
-			return true;
-		return false;
+		m_queue.push_back(queued_rowset());
+		m_queue.back().partition = _partition;
+		m_queue.back().rows = std::move(_rows);
+		queue_size++;
+		lock.unlock();
+		m_produced.notify_one();
+		return true;
 	}
 
-	// Get a field by column number (1-based)
-	const field_impl statement::field(int _num) const
-	{	
-		return field_impl(stmt_h, _num);
+	// Read one partition
+	void parallel_reader::read_partition(int _partition, const row_callback * _row_func, const rowset_callback * _rowset_func)
+	{
+		connection conn(m_dsn, m_user, m_pass);
+		statement stmt;
+		if (!conn.connected())
+			fail(_partition, conn.last_error());
+		else if (_row_func && !stmt.set_rowset_size(rowset_rows))
+			fail(_partition, __text("Invalid rowset size"));
+		else if (!b_stop && !stmt.execute_direct(conn, partition_query(_partition)))
+			fail(_partition, stmt.last_error());
+		else if (_row_func)
+		{
+			while(!b_stop)
+			{
+				if (!stmt.fetch_next())
+				{
+					_tstring error = stmt.last_error();
+					if (!error.empty())
+						fail(_partition, error);
+					break;
+				}
+				if (!(*_row_func)(_partition, stmt))
+					b_stop = true;
+			}
+		}
+		else
+		{
+			columnar_result rows;
+			while(!b_stop)
+			{
+				if (!stmt.fetch_columnar(rows, rowset_rows))
+				{
+					fail(_partition, stmt.last_error());
+					break;
+				}
+				if (rows.rows == 0)
+					break;
+				if (_rowset_func)
+				{
+					if (!(*_rowset_func)(_partition, rows))
+						b_stop = true;
+				}
+				else if (!enqueue(_partition, rows))
+					break;
+			}
+		}
+
+		stmt.close();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			n_running--;
+		}
+		m_produced.notify_all();
 	}
 
-	// Count columns of the result
-	int statement::count_columns() const
+	// Start the threads of all partitions
+	bool parallel_reader::launch(const row_callback * _row_func, const rowset_callback * _rowset_func)
 	{
-		SQLSMALLINT _total_cols;
-		RETCODE rc;
+		stop();
+		m_last_error.clear();
+		m_queue.clear();
+		queue_size = 0;
+		b_stop = false;
 
-		if (!is_open())
-			return -1;
+		// Placeholders of a key range would be sent to the server as they are
+		if (!b_key_range
+			&& ((m_query.find(__text("{lower}")) != _tstring::npos)
+				|| (m_query.find(__text("{upper}")) != _tstring::npos)))
+		{
+			m_last_error = __text("Key range is not set");
+			return false;
+		}
 
-		rc = SQLNumResultCols(stmt_h, &_total_cols);
-		if (!TIODBC_SUCCESS_CODE(rc))
-			return -1;
-		return _total_cols;
+		n_running = n_partitions;
+		for(int i = 0;i < n_partitions;i++)
+		{
+			try
+			{
+				m_threads.push_back(std::thread(&parallel_reader::read_partition, this, i, _row_func, _rowset_func));
+			}
+			catch(const std::system_error &)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					n_running -= n_partitions - i;
+				}
+				fail(i, __text("Cannot start thread"));
+				join();
+				return false;
+			}
+		}
+		return true;
 	}
 
-	// Get last error description
-	_tstring statement::last_error()
+	// Wait all partition threads
+	void parallel_reader::join()
 	{
-		_tstring error, state;
-		
-		// Get error message
-		__get_error(SQL_HANDLE_STMT, stmt_h, error, state);
+		for(size_t i = 0;i < m_threads.size();i++)
+			m_threads[i].join();
+		m_threads.clear();
+	}
 
-		return error;
+	// Read all partitions passing every row to a callback
+	bool parallel_reader::for_each_row(const row_callback & _func)
+	{
+		if (!launch(&_func, NULL))
+			return false;
+		join();
+		return !b_stop;
 	}
 
-	// Get last error code
-	_tstring statement::last_error_status_code()
+	// Read all partitions passing every rowset to a callback
+	bool parallel_reader::for_each_rowset(const rowset_callback & _func)
 	{
-		_tstring error, state;
-		
-		__get_error(SQL_HANDLE_STMT, stmt_h, error, state);
+		if (!launch(NULL, &_func))
+			return false;
+		join();
+		return !b_stop;
+	}
 
-		return state;
+	// Start reading all partitions into a merged stream
+	bool parallel_reader::start(size_t _queue_rowsets)
+	{
+		queue_limit = (_queue_rowsets > 0)?_queue_rowsets:1;
+		return launch(NULL, NULL);
 	}
 
-	// Handle a parameter
-	param_impl & statement::param(int _num)
+	// Get the next rowset of the merged stream
+	bool parallel_reader::next(columnar_result & _rows, int * _partition)
 	{
-		// Add a new if there isn't one
-		if (0 == m_params.count(_num))
-			m_params[_num] = new param_impl(stmt_h, _num);
-		
-		return *m_params[_num];
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_produced.wait(lock, [this]() { return (queue_size > 0) || (n_running == 0); });
+		if (queue_size == 0)
+		{
+			lock.unlock();
+			join();
+			return false;
+		}
+
+		_rows = std::move(m_queue.front().rows);
+		if (_partition)
+			*_partition = m_queue.front().partition;
+		m_queue.pop_front();
+		queue_size--;
+		lock.unlock();
+		m_consumed.notify_one();
+		return true;
 	}
 
-	// Reset parameters (unbind all parameters
-	void statement::reset_parameters()
+	// Stop reading and wait all partition threads
+	void parallel_reader::stop()
 	{
-		if (!is_open())
-			return;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			b_stop = true;
+		}
+		m_consumed.notify_all();
+		join();
+	}
 
-		SQLFreeStmt(stmt_h, SQL_RESET_PARAMS);
+	// Get the first error of any partition
+	_tstring parallel_reader::last_error() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_last_error;
 	}
+#endif // TIODBC_HAS_CXX11
 
 };	// !namespace tiodbc
@@ -43,7 +43,38 @@
 
 // STL Headers
 #include <string>
+#include <iosfwd>
 #include <map>
+#include <list>
+#include <vector>
+
+// Thread aware parts of the library need C++11
+#if !defined(TIODBC_HAS_CXX11) && ((__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1900)))
+#define TIODBC_HAS_CXX11
+#endif
+
+#ifdef TIODBC_HAS_CXX11
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#endif
+
+// std::optional parameters need C++17
+#if defined(TIODBC_HAS_CXX11) && !defined(TIODBC_HAS_CXX17) \
+	&& ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#define TIODBC_HAS_CXX17
+#endif
+
+#ifdef TIODBC_HAS_CXX17
+#include <optional>
+#endif
 
 //! The only one namespace of TinyODBC
 /**
@@ -59,10 +90,22 @@ namespace tiodbc
 	#endif
 
 	// Class prototypes
+	class environment;
 	class connection;
 	class field_impl;
 	class param_impl;
 	class statement;	
+	struct __stats_access;
+	struct __prefetch_state;
+	class query_profile;
+	class query_registry;
+	class batch_writer;
+#ifdef TIODBC_HAS_CXX11
+	class connection_pool;
+	class parallel_reader;
+	template<class... Ts> class typed_rows;
+	template<class T, class TNative, SQLSMALLINT CType> struct __native_column;
+#endif
 
 	//! @name Library Version
 	//! @{
@@ -93,6 +136,164 @@ namespace tiodbc
 
 	//! @}
 
+	//! An ODBC environment representation object
+	/**
+		Environment is the handle that the driver manager is initialized
+		with, connections are always allocated inside an environment.
+
+		Connections that are not given an environment explicitly attach to a
+		single process-wide environment, that is created when the first connection
+		is constructed and freed when the last one is destroyed. This way the
+		driver manager is initialized once instead of once per connection.
+	@note tiodbc::environment is <B>Uncopiable</b> and <b>NON inheritable</b>
+	*/
+	class environment
+	{
+	public:
+		friend class connection;
+
+	private:
+		HENV env_h;				//!< Handle of enviroment
+		unsigned long n_refs;	//!< Connections attached to this environment
+		bool b_shared;			//!< A flag if this is the process-wide environment
+
+		// Attach a connection to the process-wide environment
+		static environment * acquire_shared();
+
+		// Attach a connection
+		void acquire();
+
+		// Detach a connection
+		void release();
+
+		// Uncopiable
+		environment(const environment&);
+		environment & operator=(const environment&);
+
+	public:
+		//! Default constructor
+		/**
+			It allocates a new environment that asks for ODBC 3 behavior.
+		*/
+		environment();
+
+		//! Destructor
+		/**
+			It frees the environment. All connections constructed on
+			this environment must have been destroyed before it.
+		*/
+		~environment();
+
+		//! Get native HENV handle
+		/**
+		@return Actual used ODBC Environment handle for this instance.
+		*/
+		HENV native_env_handle()
+		{
+			return env_h;
+		}
+
+		//! Set how the driver manager matches pooled connections
+		/**
+		@param _relaxed If <b>True</b> connection string keywords that are not
+			important may differ (SQL_CP_RELAXED_MATCH), otherwise the connection
+			string must match exactly (SQL_CP_STRICT_MATCH).
+		@return <b>True</b> if the attribute was set.
+		@remarks For connections constructed without an environment call it on shared().
+		@see enable_driver_pooling(), shared()
+		*/
+		bool set_pool_match(bool _relaxed);
+
+		//! Enable connection pooling of the driver manager
+		/**
+			It sets SQL_ATTR_CONNECTION_POOLING for the whole process, after that
+			connection::disconnect() returns the driver connection to the driver
+			manager pool and a later connect() to the same Data Source reuses it.
+			It must be called before any connection is constructed.
+		@param _per_environment If <b>True</b> every environment has its own pool
+			(SQL_CP_ONE_PER_HENV), otherwise every driver has one (SQL_CP_ONE_PER_DRIVER).
+		@return <b>True</b> if the driver manager accepted it.
+		@remarks The process-wide environment is kept alive after enabling pooling,
+			even when no connection is attached to it, so that pooled connections
+			are not lost.
+		*/
+		static bool enable_driver_pooling(bool _per_environment = false);
+
+		//! Get the process-wide environment
+		/**
+			It is created if no connection has created it yet, and it is kept
+			alive from now on, so that attributes set on it (e.g. set_pool_match())
+			apply to all connections constructed without an environment.
+		@return The environment that connections attach to by default.
+		*/
+		static environment & shared();
+	};	// !environment
+
+	//! Counters and timers of the work done by a statement or a connection
+	/**
+		They are collected only when the library is compiled with TIODBC_ENABLE_STATS
+		defined, otherwise they stay zero and collecting them costs nothing. A
+		statement adds everything it counts to its connection as well.
+		Counting is not synchronized, objects are expected to be used by one thread at a time.
+	@note tiodbc::odbc_stats is <B>Copyable</b>, statement::stats() and connection::stats()
+		return snapshots.
+	*/
+	struct odbc_stats
+	{
+		//! ODBC functions that are counted
+		enum odbc_function
+		{
+			alloc_handle,		//!< SQLAllocHandle
+			free_handle,		//!< SQLFreeHandle
+			connect,			//!< SQLConnect
+			disconnect,			//!< SQLDisconnect
+			prepare,			//!< SQLPrepare
+			execute,			//!< SQLExecute
+			exec_direct,		//!< SQLExecDirect
+			param_data,			//!< SQLParamData
+			put_data,			//!< SQLPutData
+			fetch,				//!< SQLFetch
+			get_data,			//!< SQLGetData
+			bind_col,			//!< SQLBindCol
+			bind_parameter,		//!< SQLBindParameter
+			num_result_cols,	//!< SQLNumResultCols
+			describe_col,		//!< SQLDescribeCol
+			col_attribute,		//!< SQLColAttribute
+			stmt_attr,			//!< SQLSetStmtAttr and SQLGetStmtAttr
+			set_desc_field,		//!< SQLSetDescField
+			free_stmt,			//!< SQLFreeStmt
+			close_cursor,		//!< SQLCloseCursor
+			cancel,				//!< SQLCancel
+			connect_attr,		//!< SQLSetConnectAttr and SQLGetConnectAttr
+			end_tran,			//!< SQLEndTran
+			function_count		//!< Number of counted functions
+		};
+
+		unsigned long calls[function_count];	//!< Calls of every function
+		unsigned long long executions;		//!< Executed statements (a batch is one)
+		unsigned long long rows_fetched;	//!< Rows fetched from result sets
+		unsigned long long bytes_fetched;	//!< Bytes read with SQLGetData or fetched in bound buffers
+		unsigned long long prepare_ns;		//!< Wall time spent in prepare
+		unsigned long long execute_ns;		//!< Wall time spent in execute (including sending streamed parameters)
+		unsigned long long fetch_ns;		//!< Wall time spent in fetching rows
+		unsigned long long convert_ns;		//!< Wall time spent in reading and converting fields
+
+		//! Construct with everything zero
+		odbc_stats();
+
+		//! Set everything to zero
+		void reset();
+
+		//! Get the number of calls of all functions
+		unsigned long total_calls() const;
+
+		//! Get the name of an ODBC function, e.g. "SQLFetch"
+		static const char * function_name(odbc_function _func);
+
+		//! Add the counters of another object
+		odbc_stats & operator+=(const odbc_stats & r);
+	};
+
 	//! An ODBC connection representation object
 	/**
 		Connection object is implementing the actual connection
@@ -102,10 +303,36 @@ namespace tiodbc
 	*/
 	class connection
 	{
+	public:
+		friend class statement;
+		friend struct __stats_access;
+
 	private:
-		HENV env_h;			//!< Handle of enviroment
+		environment * p_env;	//!< Enviroment that connection is attached to
 		HDBC conn_h;		//!< Handle of connection
 		bool b_connected;	//!< A flag if we are connected
+		unsigned long conn_serial;	//!< Increased on every connect/disconnect
+
+		// Cache of prepared statements, most recently used first
+		struct cached_statement
+		{
+			_tstring sql;		//!< The prepared query
+			HSTMT stmt_h;		//!< Handle of prepared statement
+		};
+		typedef std::list<cached_statement> stmt_cache_type;
+		typedef std::map<_tstring, stmt_cache_type::iterator> stmt_cache_index_type;
+		stmt_cache_type m_stmt_cache;
+		stmt_cache_index_type m_stmt_cache_index;
+		size_t stmt_cache_size;	//!< Maximum cached statements
+		std::list<statement *> m_users;	//!< Open statements, closed before the connection is
+		odbc_stats m_stats;		//!< Counters of the connection and its statements
+		query_registry * p_queries;	//!< Registry that statements report their latencies to
+
+		// Take a prepared statement out of the cache (NULL if there isn't one)
+		HSTMT take_cached_statement(const _tstring & _sql);
+
+		// Give back a prepared statement to the cache
+		void return_cached_statement(const _tstring & _sql, HSTMT _stmt, unsigned long _serial);
 
 		// Uncopiable
 		connection(const connection&);
@@ -141,6 +368,17 @@ namespace tiodbc
 			const _tstring & _user,
 			const _tstring & _pass);
 
+		//! Construct on a specific environment
+		/**
+			It constructs a connection object that is ready
+			to connect, attached to <i>_env</i> instead of the
+			process-wide environment.
+		@param _env The environment to allocate the connection in. It
+			must outlive the connection.
+		@see connect()
+		*/
+		explicit connection(environment & _env);
+
 		//! Destructor
 		/**
 			It will disconnect (if connected) from the db and
@@ -185,7 +423,8 @@ namespace tiodbc
 		/**
 			If the object is connected it will close the connection.
 			If the object is already disconnected, calling disconnect()
-			will leave the object unaffected.
+			will leave the object unaffected. Statements still open on
+			the connection are closed first.
 
         @ref example_1
 		*/
@@ -209,16 +448,16 @@ namespace tiodbc
 		//! Get native HENV handle
 		/**
 			This is the <b>Environment</b>
-			handle that the object has allocated
-			internally with ODBC ISO API. This handle
-			can be useful to anyone who needs to use ODBC ISO API
+			handle that the object is attached to. 
+			This handle can be useful to anyone who needs to use ODBC ISO API
 			along with TinyODBC.
 		@return Actual used ODBC Environment handle for this instance.
+		@remarks The environment is shared with other connections.
 		@see native_dbc_handle()
 		*/
 		HDBC native_evn_handle()
 		{
-			return env_h;
+			return p_env->native_env_handle();
 		}
 
 		//! Get last error description
@@ -248,8 +487,328 @@ namespace tiodbc
 		@see last_error();
 		*/
 		_tstring last_error_status_code();
+
+		//! @name Prepared statements cache
+		//! @{
+
+		//! Set the maximum number of statements kept by statement::prepare_cached()
+		/**
+			Prepared statements of statement::prepare_cached() are given back
+			to the connection when they are closed, and are reused when the
+			same sql query is prepared again. When the cache is full the least
+			recently used statement is freed.
+		@param _size Maximum number of cached statements (default 32), 0
+			disables caching.
+		@see statement::prepare_cached(), clear_statement_cache()
+		*/
+		void set_statement_cache_size(size_t _size);
+
+		//! Get the maximum number of statements kept by statement::prepare_cached()
+		size_t statement_cache_size() const;
+
+		//! Free all cached prepared statements
+		/**
+			It is done automatically on disconnect().
+		*/
+		void clear_statement_cache();
+
+		//! @}
+
+		//! @name Transactions
+		//! @{
+
+		//! Turn automatic commit of every statement on or off
+		/**
+			Connections start in autocommit mode, where every executed statement
+			is a transaction of its own. When it is turned off, a transaction is
+			started implicitly and lasts until commit() or rollback().
+		@param _enabled <b>True</b> for autocommit mode.
+		@return <b>True</b> if the driver accepted it.
+		@see transaction, batch_writer
+		*/
+		bool set_autocommit(bool _enabled);
+
+		//! Check if connection is in autocommit mode
+		bool autocommit();
+
+		//! Commit the current transaction
+		/**
+		@return <b>True</b> on success, see last_error() otherwise.
+		*/
+		bool commit();
+
+		//! Roll back the current transaction
+		/**
+		@return <b>True</b> on success, see last_error() otherwise.
+		*/
+		bool rollback();
+
+		//! Set the isolation level of transactions
+		/**
+			It must be set while no transaction is open.
+		@param _level One of SQL_TXN_READ_UNCOMMITTED, SQL_TXN_READ_COMMITTED,
+			SQL_TXN_REPEATABLE_READ or SQL_TXN_SERIALIZABLE.
+		@return <b>True</b> if the driver accepted it.
+		*/
+		bool set_isolation_level(SQLUINTEGER _level);
+
+		//! Get the isolation level of transactions (0 on error)
+		SQLUINTEGER isolation_level();
+
+		//! @}
+
+		//! @name Instrumentation
+		//! @{
+
+		//! Get a snapshot of the counters of connection and all its statements
+		/**
+		@remarks Counters are collected only if the library is compiled with TIODBC_ENABLE_STATS.
+		@see odbc_stats, statement::stats()
+		*/
+		odbc_stats stats() const;
+
+		//! Set the counters of connection to zero
+		void reset_stats();
+
+#ifdef TIODBC_HAS_CXX11
+		//! Report the latencies of statements of this connection to a registry
+		/**
+			Statements prepared or executed directly after this call look up the
+			profile of their query in the registry and record every execution in it.
+		@param _registry The registry, it must outlive the connection and its
+			statements. NULL stops reporting (default).
+		@see query_registry
+		*/
+		void set_query_registry(query_registry * _registry);
+
+		//! Get the registry that statements report to (NULL if none)
+		query_registry * get_query_registry() const;
+#endif
+
+		//! @}
 	};	// !connection
 
+	//! A read-only view of a string owned by someone else
+	/**
+		It is just a pointer and a length, like std::basic_string_view,
+		the characters are not copied and they are not null terminated.
+	@note tiodbc::tstring_view is <B>Copyable</b>. It is valid only as long
+		as the string it views, see field_impl::as_string_view().
+	*/
+	class tstring_view
+	{
+	private:
+		const TCHAR * p_data;	//!< First character
+		size_t n_size;			//!< Number of characters
+
+	public:
+		//! Construct an empty view
+		tstring_view()
+			:p_data(NULL), n_size(0)
+		{}
+
+		//! Construct a view of _size characters starting at _data
+		tstring_view(const TCHAR * _data, size_t _size)
+			:p_data(_data), n_size(_size)
+		{}
+
+		//! Get pointer to the first character
+		const TCHAR * data() const		{	return p_data;	}
+
+		//! Get the number of characters
+		size_t size() const				{	return n_size;	}
+
+		//! Get the number of characters
+		size_t length() const			{	return n_size;	}
+
+		//! Check if it is empty
+		bool empty() const				{	return n_size == 0;	}
+
+		//! Get iterator to the first character
+		const TCHAR * begin() const		{	return p_data;	}
+
+		//! Get iterator past the last character
+		const TCHAR * end() const		{	return p_data + n_size;	}
+
+		//! Get a character
+		const TCHAR & operator[](size_t _pos) const	{	return p_data[_pos];	}
+
+		//! Copy viewed characters to a string
+		_tstring str() const
+		{
+			return n_size?_tstring(p_data, n_size):_tstring();
+		}
+	};
+
+	//! An exact decimal number
+	/**
+		The number is kept as an unscaled integer of up to 128 bits and a scale,
+		value = unscaled / 10^scale, the same way SQL_NUMERIC_STRUCT does. It is
+		used to move DECIMAL and NUMERIC values without converting them to text
+		or to a floating point number.
+	@note tiodbc::decimal is <B>Copyable</b>.
+	@see field_impl::as_decimal(), param_impl::set_as_decimal()
+	*/
+	class decimal
+	{
+	public:
+		SQLUBIGINT low;		//!< Lower 64 bits of the magnitude of unscaled value
+		SQLUBIGINT high;	//!< Higher 64 bits of the magnitude of unscaled value
+		bool negative;		//!< A flag if the value is negative
+		int precision;		//!< Maximum number of digits (1 to 38)
+		int scale;			//!< Number of digits after the decimal point
+
+		//! Construct a zero
+		decimal();
+
+		//! Construct from an unscaled integer
+		/**
+		@param _unscaled The value multiplied by 10^_scale, e.g. 12345 with scale 2 is 123.45
+		@param _scale The number of digits after the decimal point.
+		@param _precision The maximum number of digits.
+		*/
+		decimal(SQLBIGINT _unscaled, int _scale = 0, int _precision = 38);
+
+		//! Construct from an ODBC numeric struct
+		explicit decimal(const SQL_NUMERIC_STRUCT & _num);
+
+		//! Convert to an ODBC numeric struct
+		SQL_NUMERIC_STRUCT as_numeric() const;
+
+		//! Check if the unscaled value fits in 64 bit integer
+		bool fits_int64() const;
+
+		//! Get the unscaled value as 64 bit integer
+		/**
+		@remarks The result is valid only if fits_int64() is <b>True</b>.
+		*/
+		SQLBIGINT unscaled_int64() const;
+
+#ifdef __SIZEOF_INT128__
+		//! Get the unscaled value as 128 bit integer
+		__int128 unscaled_int128() const
+		{
+			unsigned __int128 mag = ((unsigned __int128)high << 64) | low;
+			return negative?-(__int128)mag:(__int128)mag;
+		}
+#endif
+
+		//! Get value as double (it may lose precision)
+		double as_double() const;
+
+		//! Get value as text, e.g. "-123.45"
+		_tstring as_string() const;
+
+		//! Compare exactly, numbers with different scale are equal if their values are
+		bool operator==(const decimal & r) const;
+
+		//! Compare exactly
+		bool operator!=(const decimal & r) const	{	return !(*this == r);	}
+	};
+
+	//! Receiver of the data of a field that is read in chunks
+	/**
+		Implement it to process big values (e.g. TEXT/BLOB) without
+		keeping them in memory.
+	@see field_impl::read_stream(), ostream_sink
+	*/
+	class data_sink
+	{
+	public:
+		//! Destructor
+		virtual ~data_sink() {}
+
+		//! Receive the next chunk of data
+		/**
+		@param _data The bytes of the chunk.
+		@param _size The number of bytes of the chunk.
+		@return <b>True</b> to continue or <b>False</b> to stop reading.
+		*/
+		virtual bool write(const char * _data, size_t _size) = 0;
+	};
+
+	//! A data_sink that writes to an output stream
+	/**
+	@code
+	std::ofstream out("document.pdf", std::ios::binary);
+	tiodbc::ostream_sink sink(out);
+	my_statement.field(2).read_stream(sink, true);
+	@endcode
+	*/
+	class ostream_sink : public data_sink
+	{
+	private:
+		std::ostream & out;		//!< Stream that data are written to
+
+	public:
+		//! Construct a sink writing to _out
+		explicit ostream_sink(std::ostream & _out);
+
+		//! Write the chunk to the stream, stops on stream failure
+		bool write(const char * _data, size_t _size);
+	};
+
+#ifdef TIODBC_HAS_CXX11
+	//! A data_sink that calls a function for every chunk
+	class function_sink : public data_sink
+	{
+	public:
+		//! The type of function, returns <b>False</b> to stop reading
+		typedef std::function<bool (const char *, size_t)> function_type;
+
+	private:
+		function_type func;		//!< Function that is called
+
+	public:
+		//! Construct a sink calling _func
+		explicit function_sink(function_type _func)
+			:func(std::move(_func))
+		{}
+
+		//! Call the function with the chunk
+		bool write(const char * _data, size_t _size)
+		{
+			return func(_data, _size);
+		}
+	};
+#endif // TIODBC_HAS_CXX11
+
+	//! Provider of the data of a parameter that is sent in chunks
+	/**
+		Implement it to send big values (e.g. TEXT/BLOB) without
+		keeping them in memory.
+	@see param_impl::set_as_stream(), istream_source
+	*/
+	class data_source
+	{
+	public:
+		//! Destructor
+		virtual ~data_source() {}
+
+		//! Provide the next chunk of data
+		/**
+		@param _buffer The buffer to fill with the bytes of the chunk.
+		@param _size The size of the buffer.
+		@param _read The number of bytes written in the buffer, zero at the end of data.
+		@return <b>True</b> on success or <b>False</b> to abort the execution.
+		*/
+		virtual bool read(char * _buffer, size_t _size, size_t & _read) = 0;
+	};
+
+	//! A data_source that reads from an input stream
+	class istream_source : public data_source
+	{
+	private:
+		std::istream & in;		//!< Stream that data are read from
+
+	public:
+		//! Construct a source reading from _in
+		explicit istream_source(std::istream & _in);
+
+		//! Read the next chunk from the stream, fails if the stream goes bad
+		bool read(char * _buffer, size_t _size, size_t & _read);
+	};
+
 	//! Representation of result set field.
 	/**
 	@note odbc::field_impl is <B>Copyable</b>, <b>NON inheritable</b> and <b>NOT direct constructable</b>
@@ -264,11 +823,15 @@ namespace tiodbc
 		friend class statement;
 
 	private:
+		const statement * p_stmt;	//!< Statement that field exists
 		HSTMT stmt_h;			//!< Handle of statement that field exists
 		int col_num;			//!< Column number that field exists.
 		
 		// Not direct constructible
-		field_impl(HSTMT _stmt, int _col_num);
+		field_impl(const statement * _stmt, int _col_num);
+
+		// Get the bound buffer of this field in the current rowset (NULL if not bound)
+		const char * bound_cell(SQLSMALLINT & _c_type, SQLLEN & _ind) const;
 
 	public:
 	
@@ -285,8 +848,43 @@ namespace tiodbc
 		//! @{
 
 		//! Get field as string
+		/**
+		@return The value as text, an empty string if it is NULL.
+		@see as_string_view()
+		*/
 		_tstring as_string() const;
 
+		//! Get field as a view of a string owned by the statement
+		/**
+			It works like as_string() but without allocating a new string
+			on every call. The text is kept in a buffer of the statement per column,
+			that is reused for all rows and grows when a bigger value is read,
+			and when rowset mode serves text values they are viewed directly in
+			the fetched rowset.
+		@return A view of the value as text, empty if it is NULL. It is valid until
+			the next call of statement::fetch_next() or any other operation that
+			changes the result set of the statement.
+		@see as_string()
+		*/
+		tstring_view as_string_view() const;
+
+		//! Read the field in chunks and pass them to a sink
+		/**
+			It calls SQLGetData repeatedly and hands every chunk to the sink as it
+			arrives, so values of any size can be read with a constant amount of memory.
+		@param _sink The object that will receive the chunks.
+		@param _binary If <b>True</b> the field is read as raw bytes (SQL_C_BINARY),
+			otherwise as text (SQL_C_TCHAR) without the terminating null character.
+		@param _chunk_size The size in bytes of every read from the driver.
+		@return <b>True</b> if the whole value was passed to the sink or <b>False</b>
+			if there was an error or the sink stopped reading. A NULL value passes
+			no data to the sink.
+		@remarks A field can be read only once per row. When rowset mode serves the
+			field from its buffers, only binary columns can be streamed as bytes.
+		@see data_sink, ostream_sink
+		*/
+		bool read_stream(data_sink & _sink, bool _binary = false, size_t _chunk_size = 65536) const;
+
 		//! Get field as long
 		long as_long() const;
 
@@ -305,12 +903,65 @@ namespace tiodbc
 		//! Get field as float
 		float as_float() const;
 
+		//! Get field as 64 bit integer
+		SQLBIGINT as_int64() const;
+
+		//! Get field as unsigned 64 bit integer
+		SQLUBIGINT as_uint64() const;
+
+		//! Get field as raw bytes, copied in a buffer of the caller
+		/**
+		@param _buffer The buffer to copy the bytes in.
+		@param _size The size of the buffer in bytes.
+		@return The length of the value in bytes, if it is larger than _size
+			the value was truncated. SQL_NULL_DATA if it is NULL or there was an error
+			and SQL_NO_TOTAL if it was truncated and its length is unknown.
+		@remarks When the rowset is bound, binary columns are copied from their
+			buffers and hexadecimal text of character columns is decoded to bytes.
+		*/
+		SQLLEN as_binary(void * _buffer, size_t _size) const;
+
+		//! Get field as GUID
+		/**
+		@return The GUID or a zeroed one if it is NULL or there was an error.
+		*/
+		SQLGUID as_guid() const;
+
+		//! Get field as exact decimal
+		/**
+			The value is read in SQL_C_NUMERIC form with the precision and scale of
+			the column, that are set on the application row descriptor once per result set.
+		@return The value or zero if it is NULL or there was an error.
+		@remarks When the rowset is bound, numeric columns are buffered in
+			SQL_C_NUMERIC form too.
+		*/
+		decimal as_decimal() const;
+
+		//! Get field as timestamp
+		/**
+		@return The date and time or a zeroed struct if it is NULL or there was an error.
+		*/
+		SQL_TIMESTAMP_STRUCT as_timestamp() const;
+
+#ifdef TIODBC_HAS_CXX11
+		//! Get field as a point of system clock
+		/**
+			The timestamp of the field is taken as UTC.
+		@return The time point or the epoch if it is NULL or there was an error.
+		*/
+		std::chrono::system_clock::time_point as_time_point() const;
+#endif
+
 		//! @}
 	}; // !field_impl
 
 
 	//! Handler prepared statements parameters.
 	/**
+		A parameter is bound to the statement (SQLBindParameter) only when
+		its type or buffer changes. When a prepared statement is executed many times
+		with values of the same type, setting a value just writes it in the
+		bound buffer.
 	@note tiodbc::param_impl is <B>Copyable</b>, <b>NON inheritable</b> and <b>NOT direct constructible</b>
 	@remarks
 		You <b>must</b> not create objects of this class directly but instead invoke statement::param() to get
@@ -323,14 +974,41 @@ namespace tiodbc
 		friend class statement;
 
 	private:
+		statement * p_stmt;		//!< Statement that parameter is set
 		HSTMT stmt_h;			//!< Handle of statement that parameter is set
 		int par_num;			//!< Order number of the parameter
 		_tstring _int_string;	//!< Internal string buffer
-		char _int_buffer[64];	//!< Internal buffer for small built-in types (64byte ... quite large)
-		SQLINTEGER _int_SLOIP;	//!< Internal Str Length Or Indicator Pointer
+		union
+		{
+			char _int_buffer[64];	//!< Internal buffer for small built-in types (64byte ... quite large)
+			SQLBIGINT _int_align;	//!< Aligns internal buffer for 64 bit values
+		};
+		SQLLEN _int_SLOIP;		//!< Internal Str Length Or Indicator Pointer
+		std::vector<char> _int_array;			//!< Internal buffer of array values
+		std::vector<SQLLEN> _int_array_SLOIP;	//!< Internal Str Length Or Indicator array
+		SQLULEN _int_array_rows;				//!< Rows of array values (0 if it is not an array)
+		data_source * p_source;					//!< Source of data-at-execution value (NULL if there isn't)
+		decimal _int_decimal;					//!< Internal copy of decimal value
+
+		// Current binding, a setter that needs the same binding only updates the values
+		bool b_bound;					//!< A flag if parameter is bound as described below
+		SQLSMALLINT bound_c_type;		//!< C type of bound buffer
+		SQLSMALLINT bound_sql_type;		//!< SQL type of parameter
+		SQLULEN bound_column_size;		//!< Column size of parameter
+		SQLSMALLINT bound_digits;		//!< Decimal digits of parameter
+		SQLPOINTER bound_ptr;			//!< Bound buffer
+		SQLLEN bound_length;			//!< Size of bound buffer
 		
 		// Not direct constructible
-		param_impl(HSTMT _stmt, int _par_num);
+		param_impl(statement * _stmt, int _par_num);
+
+		// Bind the parameter on _int_SLOIP, unless it is already bound the same way
+		bool bind(SQLSMALLINT _c_type, SQLSMALLINT _sql_type, SQLULEN _column_size,
+			SQLSMALLINT _digits, SQLPOINTER _ptr, SQLLEN _length);
+
+		// Store a fixed size value in internal buffer and bind it
+		template<class T>
+		const T & set_value(const T & _value, SQLSMALLINT _c_type, SQLSMALLINT _sql_type);
 
 	public:
 	
@@ -348,6 +1026,19 @@ namespace tiodbc
 
 		//! Set parameter as string
 		const _tstring & set_as_string(const _tstring & _str);
+
+		//! Set parameter as a string buffer of the caller, without copying it
+		/**
+			The buffer itself is bound to the parameter, so the caller can change its
+			contents between executions. Calling it again with the same buffer and
+			capacity only updates the length of the value.
+		@param _data The characters of the value, they must exist until the statement is executed.
+		@param _chars The number of characters of the value.
+		@param _capacity The maximum number of characters the buffer will hold, that is
+			sent to the server as the size of the parameter. 0 means _chars.
+		@return <b>True</b> if the parameter was bound or <b>False</b> if there was an error.
+		*/
+		bool set_as_external_string(const TCHAR * _data, size_t _chars, size_t _capacity = 0);
 		
 		//! Set parameter as long
 		const long & set_as_long(const long & _value);
@@ -355,40 +1046,470 @@ namespace tiodbc
 		//! Set parameter as unsigned long
 		const unsigned long & set_as_unsigned_long(const unsigned long & _value);
 
-		//! @}
-	};	// !param_impl
+		//! Set parameter as 64 bit integer (SQL_BIGINT)
+		const SQLBIGINT & set_as_int64(const SQLBIGINT & _value);
 
-	//! An ODBC statement representation object
-	/**
-		Represents a statement on the server. Statement is used to
-		execute direct queries or prepare them and execute them
-		multiple times with same or different parameters.
-		
-		A statement has a life-cycle from the time is opened
-		to the time it is closed. A closed statement can be reused
-		by reopening it.
+		//! Set parameter as unsigned 64 bit integer (SQL_BIGINT)
+		const SQLUBIGINT & set_as_uint64(const SQLUBIGINT & _value);
 
-		There is no need to directly open a statement, this is
-		done automatically from the "statement construction"
-		functions.
-	@note tiodbc::statement is <B>Uncopiable</b> and <b>NON inheritable</b>
-	*/
-	class statement
-	{
-	private:
-		HSTMT stmt_h;		//!< Handle of statement
-		bool b_open;		//!< A flag if statement has been opened
+		//! Set parameter as double (SQL_DOUBLE)
+		const double & set_as_double(const double & _value);
 
-		// List of parameters
-		typedef std::map<int, param_impl *> param_map_type;
-		typedef param_map_type::iterator param_it;
-		param_map_type m_params;
+		//! Set parameter as float (SQL_REAL)
+		const float & set_as_float(const float & _value);
 
-		// Uncopiable
-		statement(const statement&);
-		statement & operator=(const statement&);
-	
-	public:
+		//! Set parameter as raw bytes (SQL_VARBINARY)
+		/**
+		@param _data The bytes of the value, they are copied internally.
+		@param _size The number of bytes.
+		@return <b>True</b> if the parameter was bound or <b>False</b> if there was an error.
+		*/
+		bool set_as_binary(const void * _data, size_t _size);
+
+		//! Set parameter as timestamp (SQL_TYPE_TIMESTAMP)
+		/**
+		@param _value The date and time of the value.
+		@param _fraction_digits The precision of the seconds fraction that is sent to the server,
+			from 0 to 9. Some servers reject precision higher than their own timestamp type.
+		@return A reference to the internal copy of the value.
+		*/
+		const SQL_TIMESTAMP_STRUCT & set_as_timestamp(const SQL_TIMESTAMP_STRUCT & _value, int _fraction_digits = 6);
+
+		//! Set parameter as exact decimal (SQL_DECIMAL)
+		/**
+			The value is sent in SQL_C_NUMERIC form, its precision and scale are set on
+			the application parameter descriptor too.
+		@return A reference to the internal copy of the value.
+		*/
+		const decimal & set_as_decimal(const decimal & _value);
+
+		//! Set parameter to NULL
+		/**
+			If the parameter has already a value, its type is kept and only the
+			value is marked as NULL. Otherwise it is bound as a NULL string.
+		@return <b>True</b> if the parameter was bound or <b>False</b> if there was an error.
+		*/
+		bool set_as_null();
+
+		//! Set parameter to be read from a data source at execution
+		/**
+			The value is not copied, instead statement::execute() reads it from the
+			source in chunks and sends them to the server (SQLPutData) as they are read.
+			This way values of any size can be sent with a constant amount of memory.
+		@param _source The source of the value, it must exist until the statement
+			is executed.
+		@param _binary If <b>True</b> the value is sent as raw bytes (SQL_LONGVARBINARY),
+			otherwise as text (SQL_LONGVARCHAR) of TCHAR characters, like the other
+			string values. The source must then provide whole characters.
+		@param _length The total length of the value in bytes if it is known in advance,
+			some drivers require it. -1 if it is unknown.
+		@return <b>True</b> if the parameter was bound or <b>False</b> if there was an error.
+		@see data_source, istream_source
+		*/
+		bool set_as_stream(data_source & _source, bool _binary = false, SQLLEN _length = -1);
+
+		//! @}
+
+		//! @name Array assignment functions
+		//! Used to pass one value per row to statement::execute_batch()
+		//! @{
+
+		//! Set parameter as array of strings
+		bool set_as_string_array(const std::vector<_tstring> & _values);
+
+		//! Set parameter as array of longs
+		bool set_as_long_array(const std::vector<long> & _values);
+
+		//! Set parameter as array of unsigned longs
+		bool set_as_unsigned_long_array(const std::vector<unsigned long> & _values);
+
+		//! @}
+	};	// !param_impl
+
+	//! A column of a columnar_result
+	/**
+		The values of a column are kept in contiguous buffers that follow the
+		memory layout of Apache Arrow arrays, so that they can be processed
+		in bulk without any conversion.
+		- <i>values</i> holds the values back to back. Numbers are stored in their
+		native representation and fixed width binaries in <i>width</i> bytes each.
+		For variable length types it holds the bytes of all values.
+		- <i>offsets</i> is used only by variable length types and holds
+		<i>length</i> + 1 positions, value <i>i</i> is the byte range
+		[offsets[i], offsets[i + 1]) of <i>values</i>.
+		- <i>validity</i> is a bitmap with one bit per value, least significant bit
+		first, that is set when the value is not NULL. NULL values occupy a zero
+		filled slot (or an empty range) in <i>values</i>.
+	@see statement::fetch_columnar()
+	*/
+	struct result_column
+	{
+		//! Type of column values
+		enum value_type
+		{
+			int32_type,			//!< SQLINTEGER values (BIT, TINYINT, SMALLINT, INTEGER)
+			int64_type,			//!< SQLBIGINT values (BIGINT, unsigned INTEGER)
+			double_type,		//!< double values (REAL, FLOAT, DOUBLE)
+			fixed_binary_type,	//!< Byte strings of <i>width</i> bytes (BINARY, GUID as SQLGUID)
+			binary_type,		//!< Variable length byte strings (VARBINARY, LONGVARBINARY)
+			string_type			//!< Variable length character strings (all other types, as text)
+		};
+
+		_tstring name;				//!< Name of the column
+		SQLSMALLINT sql_type;		//!< SQL type of the column (e.g. SQL_INTEGER)
+		value_type type;			//!< Type of values
+		size_t width;				//!< Size of each value in bytes, zero for variable length types
+		size_t length;				//!< Number of values
+		size_t null_count;			//!< Number of NULL values
+		std::vector<unsigned char> validity;	//!< Validity bitmap
+		std::vector<char> values;				//!< Values buffer
+		std::vector<SQLINTEGER> offsets;		//!< Offsets of variable length values
+
+		//! Check if a value is NULL
+		bool is_null(size_t _row) const
+		{
+			return (validity[_row / 8] & (1 << (_row % 8))) == 0;
+		}
+
+		//! Get the values buffer as an array of T
+		/**
+			T must match the type of the column, SQLINTEGER for int32_type,
+			SQLBIGINT for int64_type and double for double_type.
+		*/
+		template<class T>
+		const T * data() const
+		{
+			return values.empty()?NULL:(const T *)&values[0];
+		}
+
+		//! Get the bytes of a value of a variable or fixed length column
+		std::string bytes(size_t _row) const
+		{
+			if (width)
+				return std::string(&values[0] + _row * width, width);
+			return std::string(values.begin() + offsets[_row], values.begin() + offsets[_row + 1]);
+		}
+	};
+
+	//! A result set materialized by columns
+	/**
+	@see statement::fetch_columnar()
+	*/
+	struct columnar_result
+	{
+		size_t rows;							//!< Number of rows
+		std::vector<result_column> columns;		//!< Columns of the result set
+
+		//! Default constructor
+		columnar_result()
+			:rows(0)
+		{}
+	};
+
+	//! Description of a column of a result set
+	/**
+	@see statement::columns()
+	*/
+	struct column_descriptor
+	{
+		_tstring name;					//!< Name of the column
+		SQLSMALLINT sql_type;			//!< SQL type of the column (e.g. SQL_INTEGER)
+		SQLULEN size;					//!< Size of the column (e.g. maximum characters of VARCHAR)
+		SQLSMALLINT decimal_digits;		//!< Decimal digits of the column
+		bool nullable;					//!< A flag if the column may contain NULL values
+	};
+
+	//! @cond INTERNAL_FUNCTIONS
+	// Storage of a parameter of statement::execute(args...)
+	struct __param_slot
+	{
+		union
+		{
+			unsigned char b;
+			SQLSMALLINT s;
+			SQLINTEGER l;
+			SQLBIGINT ll;
+			SQLUBIGINT ull;
+			float f;
+			double d;
+		} value;						// Value of numbers
+		SQLPOINTER ptr;					// Value of strings (NULL for numbers and NULL values)
+		SQLLEN length;					// Size of value buffer (0 if there is none)
+		SQLLEN ind;						// Length or indicator
+		SQLULEN column_size;			// Column size of parameter
+		SQLSMALLINT c_type;				// C type of value
+		SQLSMALLINT sql_type;			// SQL type of parameter
+	};
+	//! @endcond
+
+	//! Progress of an asynchronous operation of a statement
+	/**
+		It is returned by the asynchronous functions of statement, e.g.
+		statement::execute_async(). The operation runs at the driver while
+		the application does other work, but it advances only when it is polled.
+		poll() asks the driver once without blocking and wait() polls
+		until the operation is complete, so a single thread can keep many
+		statements in flight.
+		@code
+		tiodbc::async_result r1 = stmt1.execute_direct_async(conn1, "SELECT * FROM books");
+		tiodbc::async_result r2 = stmt2.execute_direct_async(conn2, "SELECT * FROM authors");
+		while(!r1.poll() || !r2.poll())
+			do_other_work();
+		@endcode
+	@note tiodbc::async_result is <B>Copyable</b>, all copies refer to the same
+		statement. A statement runs one operation at a time, and must not be used
+		otherwise until its operation is complete.
+	*/
+	class async_result
+	{
+	public:
+		friend class statement;
+
+	private:
+		statement * p_stmt;		//!< Statement that runs the operation
+
+		// Not direct constructible
+		explicit async_result(statement * _stmt);
+
+	public:
+		//! Construct an invalid result, that is always ready with result() <b>False</b>
+		async_result();
+
+		//! Check if it refers to a statement
+		bool valid() const;
+
+		//! Poll the driver once
+		/**
+		@return <b>True</b> if the operation is complete or <b>False</b> if it is still executing.
+		*/
+		bool poll();
+
+		//! Check if the operation is complete, without polling
+		bool ready() const;
+
+		//! Get the result of the complete operation
+		/**
+		@return What the synchronous version of the operation would return, in case
+			of error check statement::last_error() for detailed description of problem.
+			<b>False</b> if the operation is not complete.
+		*/
+		bool result() const;
+
+		//! Cancel the operation
+		/**
+			It completes with result() <b>False</b>.
+		*/
+		void cancel();
+
+#ifdef TIODBC_HAS_CXX11
+		//! Poll until the operation is complete or timeout
+		/**
+			It sleeps between polls, starting from a few microseconds and
+			backing off up to 10 milliseconds.
+		@param _timeout_ms Maximum time to wait in milliseconds.
+		@return <b>True</b> if the operation is complete or <b>False</b> on timeout.
+		*/
+		bool wait(unsigned long _timeout_ms);
+
+		//! Get a future that receives result() when the operation completes
+		/**
+			The operation must still be polled by someone, e.g. an I/O thread that
+			polls all pending operations while other threads wait on their futures.
+		*/
+		std::future<bool> get_future();
+#endif // TIODBC_HAS_CXX11
+	};
+
+	//! An ODBC statement representation object
+	/**
+		Represents a statement on the server. Statement is used to
+		execute direct queries or prepare them and execute them
+		multiple times with same or different parameters.
+		
+		A statement has a life-cycle from the time is opened
+		to the time it is closed. A closed statement can be reused
+		by reopening it.
+
+		There is no need to directly open a statement, this is
+		done automatically from the "statement construction"
+		functions.
+	@note tiodbc::statement is <B>Uncopiable</b> and <b>NON inheritable</b>
+	*/
+	class statement
+	{
+	public:
+		friend class field_impl;
+		friend class param_impl;
+		friend class async_result;
+		friend class batch_writer;
+		friend struct __stats_access;
+		friend struct __prefetch_state;
+		template<class T> friend T __get_data(const statement *, HSTMT, int, SQLSMALLINT, T);
+#ifdef TIODBC_HAS_CXX11
+		template<class... Ts> friend class typed_rows;
+		template<class T, class TNative, SQLSMALLINT CType> friend struct __native_column;
+#endif
+
+	private:
+		HSTMT stmt_h;		//!< Handle of statement
+		bool b_open;		//!< A flag if statement has been opened
+		connection * p_conn;	//!< Connection that statement is open on (NULL if closed)
+
+		// Prepared statement cache
+		bool b_cached;			//!< A flag if handle must be given back to connection cache
+		_tstring cached_sql;	//!< The query that handle is cached with
+		unsigned long conn_serial;	//!< Connection serial at the time handle was taken
+
+		mutable odbc_stats m_stats;	//!< Counters of statement
+
+		// Latency profile of the query
+		query_profile * p_query;	//!< Profile of the prepared or executed query (NULL if not reported)
+		_tstring profiled_sql;		//!< Query text that p_query was looked up for
+		unsigned long long query_fetch_start;	//!< Time that fetching started at (0 if not timed)
+
+		// Look up the profile of a query in the registry of connection
+		void profile_query(const _tstring & _sql, bool _prepared);
+
+		// Start timing an execution of the profiled query (0 if it is not profiled)
+		unsigned long long start_query_timer() const;
+
+		// Record an execution of the profiled query and start timing its fetch
+		void record_query_execution(unsigned long long _start, bool _success);
+
+		// Record fetch-to-completion latency when the result set is exhausted
+		void complete_query_fetch();
+
+		// List of parameters
+		typedef std::map<int, param_impl *> param_map_type;
+		typedef param_map_type::iterator param_it;
+		param_map_type m_params;
+
+		// Column buffer of block cursor
+		struct bound_column
+		{
+			SQLSMALLINT c_type;				//!< C type of buffer
+			SQLLEN width;					//!< Size of one row in buffer
+			std::vector<char> data;			//!< Values of all rows of rowset
+			std::vector<SQLLEN> indicators;	//!< Length/indicator of all rows of rowset
+			const char * p_values;			//!< Values of current rowset (data or a prefetched rowset)
+			const SQLLEN * p_indicators;	//!< Length/indicator of current rowset
+		};
+
+		// Block cursor
+		SQLULEN rowset_rows;		//!< Requested rows per fetch
+		SQLULEN rows_fetched;		//!< Rows of last fetched rowset
+		SQLULEN rowset_pos;			//!< Current row inside rowset
+		bool b_rowset_bound;		//!< A flag if columns are bound for block fetching
+		std::vector<bound_column> m_bound_columns;
+		std::vector<SQLUSMALLINT> m_row_status;
+
+		// Background prefetch of rowsets
+		unsigned long prefetch_rowsets;		//!< Rowsets fetched ahead of the application (0 if disabled)
+		__prefetch_state * p_prefetch;		//!< Thread and buffers prefetching the current result set
+		bool b_prefetch_ready;				//!< A flag if prefetching starts at the first fetch_next() of the result set
+
+		// Bind a column of the result set to block cursor buffers
+		bool bind_rowset_column(int _col_num, char * _values, SQLLEN * _indicators);
+
+		// Start prefetching the rowsets of the bound result set, false if it is not possible
+		bool start_prefetch();
+
+		// Stop the prefetch thread and unbind the rowset, the prefetched rows are lost
+		void stop_prefetch();
+
+		// Take the next prefetched rowset, returns the code of its SQLFetch
+		RETCODE next_prefetched_rowset();
+
+		// Columns of current result set
+		mutable bool b_described;		//!< A flag if columns have been described
+		mutable std::vector<column_descriptor> m_columns;
+		mutable std::vector<int> m_name_index;	//!< Open addressing hash table of column numbers by name
+		mutable std::vector<char> m_numeric_ard;	//!< A flag per column if its row descriptor is set for SQL_C_NUMERIC
+
+		// Describe the columns of the result set once
+		bool describe() const;
+
+		// Text of fields of current row
+		struct text_buffer
+		{
+			std::vector<TCHAR> data;	//!< Characters of value
+			size_t length;				//!< Length of value
+			unsigned long serial;		//!< Fetch serial that value was read at
+		};
+		unsigned long fetch_serial;		//!< Serial of the current row
+		mutable std::vector<text_buffer> m_text_buffers;
+		mutable std::vector<char> m_stream_buffer;	//!< Chunk buffer of field_impl::read_stream()
+
+		// Diagnostics of a failed operation that were cleared by the cleanup after it
+		_tstring saved_error;			//!< Error description
+		_tstring saved_error_state;		//!< Error status code
+		unsigned long saved_error_serial;	//!< Fetch serial that operation failed at
+
+		// Keep the diagnostics of a failed operation for last_error()
+		void save_error();
+
+		// Asynchronous execution
+		enum async_operation
+		{
+			async_none,
+			async_execute,
+			async_execute_direct,
+			async_fetch
+		};
+		int async_op;					//!< Operation in progress
+		_tstring async_query;			//!< Query of async_execute_direct
+		unsigned long long async_query_start;	//!< Time that the asynchronous execution started at (0 if not timed)
+		bool b_async_result;			//!< Result of last complete operation
+#ifdef TIODBC_HAS_CXX11
+		std::vector<std::promise<bool> > m_async_promises;
+#endif
+
+		// Array parameters
+		SQLULEN params_processed;	//!< Parameter sets processed by last batch
+		std::vector<SQLUSMALLINT> m_param_status;
+
+		// Parameters of execute(args...), bound between executions
+		std::vector<__param_slot> m_param_slots;	//!< Bound slot per marker (c_type 0 if not bound)
+		std::vector<_tstring> m_param_texts;		//!< Copy of the string value per marker
+
+		// Mark the slot of a marker as no longer bound by execute(args...)
+		void release_param_slot(int _par_num);
+
+		// Bind columns of result set for block fetching
+		bool bind_rowset();
+
+		// Unbind block fetching buffers
+		void unbind_rowset();
+
+		// Bind the first columns of result set for block fetching with the given C types
+		bool bind_typed(const SQLSMALLINT * _c_types, int _count);
+
+		// Get the bound buffer of a column in the current row (NULL if not bound)
+		const char * typed_cell(int _col_num, SQLLEN & _ind, SQLLEN & _width) const;
+
+		// Read a column of the current row with SQLGetData
+		bool get_data(int _col_num, SQLSMALLINT _c_type, void * _buf, SQLLEN _size, SQLLEN & _ind) const;
+
+		// Copy parameters to the bound slots, bind the changed ones and execute
+		bool execute_params(const __param_slot * _slots, int _count);
+
+		// Send the values of data-at-execution parameters
+		RETCODE put_stream_data();
+
+		// Start an asynchronous operation
+		async_result start_async(int _op);
+
+		// Call the function of the asynchronous operation again, true when it is complete
+		bool poll_async();
+
+		// Complete the asynchronous operation
+		void complete_async(bool _result);
+
+		// Uncopiable
+		statement(const statement&);
+		statement & operator=(const statement&);
+	
+	public:
 		//! Default constructor
 		/**
 			It will construct a statement ready
@@ -490,6 +1611,8 @@ namespace tiodbc
 			return an empty string, otherwise it will return
 			the description of the error that occurred inside
 			the ODBC driver.
+		@remarks While rowsets are prefetched (see set_prefetch()) only the error
+			of a failed prefetch is reported, the handle is not read.
 		@see last_error_status_code()
 		*/
 		_tstring last_error();
@@ -540,6 +1663,29 @@ namespace tiodbc
 		*/
 		bool prepare(connection & _conn, const _tstring & _stmt);
 
+		//! Prepare a query reusing a cached prepared statement
+		/**
+			It works like prepare() but the connection keeps the prepared
+			statement when this statement is closed, and hands it back on
+			the next prepare_cached() of the same sql query instead of preparing
+			it again at the server. A statement that comes from the cache has its
+			parameters reset and its cursor closed, ready to be executed.
+
+		@param _conn The connection object to prepare the query
+			on it.
+		@param _stmt The sql query to prepare.
+		@return <b>True</b> if the preparation was successful or <b>False</b> if
+			there was an error. In case of error check last_error() for detailed
+			description of error.
+		@remarks If the connection is disconnected or destroyed first, the statement
+			is closed by it, like any other statement.
+		@note This is a <b>"statement construction" function</b> which means
+			that any previous opened operation of this statement will be closed
+			and a new statement will be created.
+		@see connection::set_statement_cache_size(), prepare()
+		*/
+		bool prepare_cached(connection & _conn, const _tstring & _stmt);
+
 		//! Execute directly an sql query to the server.
 		/**
 			It will close any previous opened operation and will execute
@@ -601,6 +1747,37 @@ namespace tiodbc
 		*/
 		bool execute();
 
+#ifdef TIODBC_HAS_CXX11
+		//! Execute a prepared statement with the given parameters
+		/**
+			The arguments are the values of the parameter markers, from left to right.
+			Their C and SQL types are deduced at compile time, see typed_param for the
+			supported types. Values, strings included, are copied into a block of the
+			statement that stays bound between executions, so a parameter is bound
+			again only when its type changes or a string outgrows its buffer.
+			@code
+			my_statement.prepare(my_connection, "INSERT INTO books (id, title, price) VALUES(?, ?, ?)");
+			my_statement.execute(1, std::string("TinyODBC Manual"), 9.99);
+			@endcode
+		@return <b>True</b> if the prepared query was successfully executed
+			or <b>False</b> if there was an error. In case of error
+			check last_error() for detailed description of problem.
+		@remarks The parameters stay bound after the call, a following execute()
+			without arguments reuses their values. Setting a parameter with param()
+			replaces the binding of its marker.
+		@see execute(), prepare_and_execute()
+		*/
+		template<class... Ts>
+		bool execute(const Ts &... _args);
+
+		//! Prepare a query and execute it with the given parameters
+		/**
+		@see prepare(), execute(const Ts &...)
+		*/
+		template<class... Ts>
+		bool prepare_and_execute(connection & _conn, const _tstring & _stmt, const Ts &... _args);
+#endif // TIODBC_HAS_CXX11
+
 		//! Fetch next result row
 		/**
 			If the statement has opened a result set, it
@@ -643,10 +1820,66 @@ namespace tiodbc
 		*/
 		const field_impl field(int _num) const;
 
+		//! Get a field of the current row by column name
+		/**
+			It works like field(int) but finds the column by its name, the
+			first column with this name is used. Names are matched case-insensitively.
+		@param _name The name of the column.
+		@return A field_impl object, invalid if there isn't any column with this name.
+		@remarks Looking up a name is cheap but not free. For scans of many rows find
+			the column once with find_column() and use field(int) in the loop.
+		@see find_column()
+		*/
+		const field_impl field(const _tstring & _name) const;
+
+#ifdef TIODBC_HAS_CXX11
+		//! Iterate the rows of the result set as typed tuples
+		/**
+			The type of every column is given as template parameter, and it
+			selects at compile time the C type that the column is bound with,
+			see typed_column for the supported types. The first sizeof...(Ts)
+			columns are bound once and fetched in blocks, so reading a row is just
+			copying values out of the buffers into the same tuple, whose strings
+			keep their storage from row to row.
+			@code
+			for(const auto & [id, title, price] : my_statement.rows<int, std::string, double>())
+				cout << id << " " << title << " " << price << endl;
+			@endcode
+		@return A range of std::tuple<Ts...> rows, that can be iterated once. It is empty
+			if the result set has less columns than the types or fetch_next() is
+			prefetching it.
+		@remarks NULL values are returned as T(). If a string column is too big to be
+			buffered (e.g. TEXT) the rows are fetched one by one with SQLGetData.
+			While the rows are fetched in blocks, the columns after the typed ones
+			are not bound and field() can not read them.
+		@see set_rowset_size()
+		*/
+		template<class... Ts>
+		typed_rows<Ts...> rows();
+#endif // TIODBC_HAS_CXX11
+
+		//! Find a column of the result set by name
+		/**
+			Names are hashed once per result set when the columns are described,
+			so finding a column does not involve the driver.
+		@param _name The name of the column.
+		@param _case_sensitive If <b>True</b> the name must match exactly, otherwise
+			ASCII letters are matched case-insensitively.
+		@return The column number, first column is the 1, that stays valid for all rows
+			of the result set, or 0 if there isn't any column with this name.
+		@code
+		int title = my_statement.find_column("title");
+		while(my_statement.fetch_next())
+			cout << my_statement.field(title).as_string() << endl;
+		@endcode
+		*/
+		int find_column(const _tstring & _name, bool _case_sensitive = false) const;
+
 		//! Count columns of the result set
 		/**
 			It will return the number of columns of the
-			current open result set.
+			current open result set. Columns are described once per
+			result set, so it can be called for every row without any cost.
 		@return
 			- If the operation was <b>successful</b> it will return a number
 			<b>bigger than zero</b>.
@@ -656,9 +1889,110 @@ namespace tiodbc
 		*/
 		int count_columns() const;
 
+		//! Get the description of all columns of the result set
+		/**
+			Columns are described (SQLDescribeCol) the first time they are
+			needed after every execution, and then served from memory.
+		@return The columns of the current result set, empty if there isn't any.
+		*/
+		const std::vector<column_descriptor> & columns() const;
+
+		//! Get the name of a column of the result set
+		/**
+		@param _num The column number, first column is the 1.
+		@return The name or an empty string if the number is wrong.
+		*/
+		_tstring column_name(int _num) const;
+
+		//! Get the SQL type of a column of the result set
+		/**
+		@param _num The column number, first column is the 1.
+		@return The SQL type (e.g. SQL_VARCHAR) or SQL_UNKNOWN_TYPE if the number is wrong.
+		*/
+		SQLSMALLINT column_type(int _num) const;
+
+		//! Get the size of a column of the result set
+		/**
+		@param _num The column number, first column is the 1.
+		@return The size as reported by the driver or 0 if the number is wrong.
+		*/
+		SQLULEN column_size(int _num) const;
+
 		//! Free current opened result set.
 		void free_results();
 
+		//! Set the number of rows that are fetched from the driver at once
+		/**
+			When the rowset size is bigger than one, every executed result set
+			is bound to internal column buffers and fetched in blocks of
+			<i>_rows</i> rows. fetch_next() will then advance a cursor inside
+			the fetched rowset and call the driver only when the rowset is
+			exhausted, while field() serves values directly from the buffers.
+		@param _rows Rows to fetch at once. 1 (default) fetches row by row.
+		@return <b>True</b> if the size was accepted or <b>False</b> if <i>_rows</i>
+			is zero.
+		@remarks The new size is used from the next execution. Numeric, timestamp,
+			GUID and binary columns are buffered natively and all others as text,
+			if a result set has a column of unknown or very large size (e.g. TEXT/BLOB)
+			it is fetched row by row.
+		@see rowset_size(), fetch_next()
+		*/
+		bool set_rowset_size(unsigned long _rows);
+
+		//! Get the number of rows that are fetched from the driver at once
+		/**
+		@see set_rowset_size()
+		*/
+		unsigned long rowset_size() const;
+
+#ifdef TIODBC_HAS_CXX11
+		//! Fetch rowsets on a background thread ahead of the application
+		/**
+			When enabled, a thread fetches the next rowsets of a block cursor into
+			their own buffers while the application processes the current one
+			with fetch_next() and field(). With <i>_rowsets</i> 1 it is double
+			buffering, rowset k + 1 is fetched while rowset k is processed.
+		@param _rowsets Rowsets fetched ahead, 0 (default) disables prefetching.
+		@remarks It is used from the next execution and only with a block cursor
+			(see set_rowset_size()). The thread starts at the first fetch_next() of
+			a result set. While a result set is prefetched the statement must not be
+			used from another thread, fetch_columnar() and rows() refuse to read it,
+			and executing or binding parameters drops the rows fetched ahead after
+			waiting the fetch in progress. last_error() reports the error of a failed
+			prefetch, but not the diagnostics of other calls until the result set is
+			freed.
+		@see prefetch(), set_rowset_size()
+		*/
+		void set_prefetch(unsigned long _rowsets);
+
+		//! Get the number of rowsets fetched ahead
+		/**
+		@see set_prefetch()
+		*/
+		unsigned long prefetch() const;
+#endif // TIODBC_HAS_CXX11
+
+		//! Fetch the remaining rows of the result set by columns
+		/**
+			It will fetch the rest of the current result set, with a block
+			cursor when possible, and store it in typed column buffers
+			that follow the Arrow memory layout.
+		@param _result The object that will receive the columns, any previous
+			contents are discarded.
+		@param _max_rows Maximum number of rows to fetch, 0 to fetch all of them.
+			Calling it again continues with the next rows.
+		@return <b>True</b> if the rows were fetched (possibly none) or <b>False</b>
+			if there isn't any result set or there was an error. In case of error
+			check last_error() for detailed description of problem.
+		@remarks Rows already buffered by fetch_next() in rowset mode are not included,
+			so fetch_columnar() should be called before fetch_next() on a result set.
+			It returns <b>False</b> if fetch_next() is prefetching the result set.
+			Columns of very large size (e.g. TEXT/BLOB) are supported, but force the
+			whole result set to be fetched row by row.
+		@see result_column, set_rowset_size()
+		*/
+		bool fetch_columnar(columnar_result & _result, unsigned long _max_rows = 0);
+
 		//! @}
 
 		//! @name Parameters handling
@@ -695,8 +2029,1199 @@ namespace tiodbc
 		*/
 		void reset_parameters();
 
+		//! Execute a prepared statement for a batch of parameter rows
+		/**
+			It will execute the prepared query once for every row of the
+			parameter arrays, sending all of them to the server with a single
+			call (SQL_ATTR_PARAMSET_SIZE).
+
+			All the parameters must have been set with the array functions of
+			param_impl (e.g. param_impl::set_as_long_array()) with at least
+			<i>_rows</i> values each. It fails if a parameter is still bound
+			by execute(args...).
+		@param _rows The number of parameter rows to execute.
+		@return <b>True</b> if the batch was executed or <b>False</b> if
+			there was an error. In case of error check last_error() and
+			batch_status() to find out which rows failed.
+		@see batch_status(), batch_processed(), param()
+		*/
+		bool execute_batch(unsigned long _rows);
+
+		//! Get the status of every row of the last batch
+		/**
+		@return One SQL_PARAM_* status code (e.g. SQL_PARAM_SUCCESS, SQL_PARAM_ERROR,
+			SQL_PARAM_UNUSED) per row of the last execute_batch().
+		@see execute_batch()
+		*/
+		const std::vector<SQLUSMALLINT> & batch_status() const;
+
+		//! Get the number of rows processed by the last batch
+		/**
+		@see execute_batch()
+		*/
+		unsigned long batch_processed() const;
+
+		//! @}
+
+		//! @name Asynchronous execution
+		//! Statement is switched to asynchronous mode (SQL_ATTR_ASYNC_ENABLE) for the
+		//! duration of the operation, drivers that do not support it complete it synchronously.
+		//! @{
+
+		//! Execute directly an sql query to the server, asynchronously
+		/**
+		@see execute_direct(), async_result
+		*/
+		async_result execute_direct_async(connection & _conn, const _tstring & _query);
+
+		//! Execute a prepared statement, asynchronously
+		/**
+		@return An async_result of the operation, or an invalid one if another operation
+			is still executing.
+		@remarks Parameters set with param_impl::set_as_stream() are not supported.
+		@see execute(), async_result
+		*/
+		async_result execute_async();
+
+		//! Fetch next result row, asynchronously
+		/**
+			In rowset mode the driver is called only when the fetched rowset is exhausted,
+			otherwise the operation completes immediately.
+		@see fetch_next(), async_result
+		*/
+		async_result fetch_next_async();
+
+		//! @}
+
+		//! @name Instrumentation
+		//! @{
+
+		//! Get a snapshot of the counters of statement
+		/**
+			The counters are kept across executions and until reset_stats() is called.
+		@remarks Counters are collected only if the library is compiled with TIODBC_ENABLE_STATS.
+		@see odbc_stats, connection::stats()
+		*/
+		odbc_stats stats() const;
+
+		//! Set the counters of statement to zero
+		void reset_stats();
+
 		//! @}
 	};	// !statement
+
+	//! A transaction scope
+	/**
+		It turns off autocommit mode of a connection for its lifetime. Unless
+		commit() is called, the transaction is rolled back when the object is
+		destroyed, and autocommit mode is restored as it was.
+	@code
+	{
+		tiodbc::transaction trans(my_connection);
+		stmt_a.execute();
+		stmt_b.execute();
+		trans.commit();
+	}	// Rolled back here if commit() was not reached
+	@endcode
+	@note tiodbc::transaction is <B>Uncopiable</b>
+	*/
+	class transaction
+	{
+	private:
+		connection * p_conn;	//!< Connection of transaction
+		bool b_active;			//!< A flag if transaction has not ended yet
+		bool b_autocommit;		//!< Autocommit mode to restore
+
+		// Uncopiable
+		transaction(const transaction &);
+		transaction & operator=(const transaction &);
+
+	public:
+		//! Start a transaction on a connection
+		/**
+			Check active() to see if autocommit mode could be turned off.
+		*/
+		explicit transaction(connection & _conn);
+
+		//! Destructor, rolls back if transaction is still active (or its commit failed)
+		~transaction();
+
+		//! Check if transaction has started and not ended yet
+		bool active() const;
+
+		//! Commit and end the transaction
+		/**
+		@return <b>True</b> on success. If the commit failed the transaction
+			stays active, so that it can be rolled back.
+		*/
+		bool commit();
+
+		//! Roll back and end the transaction
+		bool rollback();
+	};	// !transaction
+
+	//! Executes a prepared statement and commits in batches
+	/**
+		Committing every row forces the server to flush its log for every row.
+		batch_writer turns off autocommit mode and commits once every N rows
+		and/or every T milliseconds instead. Rows that are still pending when
+		the writer is destroyed are rolled back, so the last batch must be
+		committed with commit(). Autocommit mode is restored afterwards.
+	@code
+	tiodbc::statement ins(my_connection, "INSERT INTO t VALUES(?, ?)");
+	tiodbc::batch_writer writer(ins, 1000, 500);
+	for(...)
+	{
+		ins.param(1).set_as_long(id);
+		ins.param(2).set_as_string(name);
+		if (!writer.execute())
+			break;
+	}
+	writer.commit();
+	@endcode
+	@note tiodbc::batch_writer is <B>Uncopiable</b>
+	*/
+	class batch_writer
+	{
+	private:
+		statement * p_stmt;			//!< Statement that is executed
+		connection * p_conn;		//!< Connection of statement
+		unsigned long commit_rows;	//!< Rows per commit (0 for no limit)
+		unsigned long long commit_ns;	//!< Time between commits (0 for no limit)
+		unsigned long long batch_start;	//!< Time that first pending row was written
+		unsigned long pending_rows;		//!< Rows written since last commit
+		unsigned long long committed_rows;	//!< Rows committed
+		unsigned long n_commits;		//!< Commits done
+		bool b_autocommit;			//!< Autocommit mode to restore
+		bool b_ready;				//!< A flag if autocommit was turned off
+
+		// Count written rows and commit if a limit was reached
+		bool add_rows(unsigned long _rows);
+
+		// Uncopiable
+		batch_writer(const batch_writer &);
+		batch_writer & operator=(const batch_writer &);
+
+	public:
+		//! Construct on a prepared statement
+		/**
+		@param _stmt The prepared statement that will be executed.
+		@param _commit_rows Commit when this many rows are pending, 0 for no limit.
+		@param _commit_ms Commit when the first pending row was written this many
+			milliseconds ago, 0 for no limit. It is checked after every execution.
+		*/
+		batch_writer(statement & _stmt, unsigned long _commit_rows, unsigned long _commit_ms = 0);
+
+		//! Destructor, rolls back pending rows and restores autocommit mode
+		~batch_writer();
+
+		//! Check if autocommit mode was turned off and the writer can be used
+		bool ready() const;
+
+		//! Execute the statement with its current parameters
+		/**
+			It commits afterwards if a limit was reached.
+		@return <b>False</b> if execution or commit failed, see statement::last_error()
+			or connection::last_error().
+		*/
+		bool execute();
+
+		//! Execute the statement for a batch of parameter rows
+		/**
+		@see statement::execute_batch()
+		*/
+		bool execute_batch(unsigned long _rows);
+
+		//! Commit the pending rows
+		bool commit();
+
+		//! Roll back the pending rows
+		bool rollback();
+
+		//! Get the number of rows written but not committed yet
+		unsigned long pending() const;
+
+		//! Get the number of rows committed
+		unsigned long long committed() const;
+
+		//! Get the number of commits done
+		unsigned long commits() const;
+	};	// !batch_writer
+
+#ifdef TIODBC_HAS_CXX11
+	//! Mapping of a C++ type to the C type of a bound column
+	/**
+		Specializations exist for bool, all integer types, float, double
+		and _tstring. Using any other type with statement::rows() fails
+		to compile.
+	*/
+	template<class T>
+	struct typed_column;
+
+	//! @cond INTERNAL_FUNCTIONS
+	template<class T, class TNative, SQLSMALLINT CType>
+	struct __native_column
+	{
+		static const SQLSMALLINT c_type = CType;
+
+		// Read a value from a bound buffer
+		static void read(T & _value, const char * _cell, SQLLEN _ind, SQLLEN)
+		{
+			_value = (_ind == SQL_NULL_DATA)?T():(T)*(const TNative *)_cell;
+		}
+
+		// Read a value with SQLGetData
+		static void get(T & _value, const statement & _stmt, int _col_num)
+		{
+			TNative value;
+			SQLLEN ind;
+			if (!_stmt.get_data(_col_num, CType, &value, sizeof(value), ind) || (ind == SQL_NULL_DATA))
+				_value = T();
+			else
+				_value = (T)value;
+		}
+	};
+
+	template<class T, bool Wide = (sizeof(T) > sizeof(SQLINTEGER))>
+	struct __long_column
+		:__native_column<T, SQLBIGINT, SQL_C_SBIGINT> {};
+	template<class T>
+	struct __long_column<T, false>
+		:__native_column<T, SQLINTEGER, SQL_C_SLONG> {};
+	template<class T, bool Wide = (sizeof(T) > sizeof(SQLUINTEGER))>
+	struct __ulong_column
+		:__native_column<T, SQLUBIGINT, SQL_C_UBIGINT> {};
+	template<class T>
+	struct __ulong_column<T, false>
+		:__native_column<T, SQLUINTEGER, SQL_C_ULONG> {};
+	//! @endcond
+
+	template<> struct typed_column<bool>
+		:__native_column<bool, unsigned char, SQL_C_BIT> {};
+	template<> struct typed_column<short>
+		:__native_column<short, SQLSMALLINT, SQL_C_SSHORT> {};
+	template<> struct typed_column<unsigned short>
+		:__native_column<unsigned short, SQLUSMALLINT, SQL_C_USHORT> {};
+	template<> struct typed_column<int>
+		:__long_column<int> {};
+	template<> struct typed_column<unsigned int>
+		:__ulong_column<unsigned int> {};
+	template<> struct typed_column<long>
+		:__long_column<long> {};
+	template<> struct typed_column<unsigned long>
+		:__ulong_column<unsigned long> {};
+	template<> struct typed_column<long long>
+		:__long_column<long long> {};
+	template<> struct typed_column<unsigned long long>
+		:__ulong_column<unsigned long long> {};
+	template<> struct typed_column<float>
+		:__native_column<float, float, SQL_C_FLOAT> {};
+	template<> struct typed_column<double>
+		:__native_column<double, double, SQL_C_DOUBLE> {};
+
+	template<> struct typed_column<_tstring>
+	{
+		static const SQLSMALLINT c_type = SQL_C_TCHAR;
+
+		// Read a value from a bound buffer, reusing the storage of the previous row
+		static void read(_tstring & _value, const char * _cell, SQLLEN _ind, SQLLEN _width)
+		{
+			if (_ind == SQL_NULL_DATA)
+			{
+				_value.clear();
+				return;
+			}
+			SQLLEN max_chars = _width / (SQLLEN)sizeof(TCHAR) - 1;
+			SQLLEN chars = ((_ind < 0) || (_ind / (SQLLEN)sizeof(TCHAR) > max_chars))?max_chars:_ind / (SQLLEN)sizeof(TCHAR);
+			_value.assign((const TCHAR *)_cell, chars);
+		}
+
+		// Read a value with SQLGetData
+		static void get(_tstring & _value, const statement & _stmt, int _col_num)
+		{
+			tstring_view text = _stmt.field(_col_num).as_string_view();
+			_value.assign(text.data(), text.size());
+		}
+	};
+
+	//! A range of the rows of a result set as typed tuples
+	/**
+		It is returned by statement::rows(). The range is an input range,
+		iterating it fetches the rows of the statement.
+	@see statement::rows()
+	*/
+	template<class... Ts>
+	class typed_rows
+	{
+	public:
+		//! Type of a row
+		typedef std::tuple<Ts...> value_type;
+
+		//! Iterator of the rows
+		class iterator
+		{
+		private:
+			statement * p_stmt;		//!< Statement that rows are fetched from (NULL at end)
+			value_type row;			//!< Current row
+
+			template<size_t I>
+			typename std::enable_if<(I == sizeof...(Ts))>::type load()
+			{}
+
+			template<size_t I>
+			typename std::enable_if<(I < sizeof...(Ts))>::type load()
+			{
+				typedef typed_column<typename std::tuple_element<I, value_type>::type> column;
+				SQLLEN ind, width;
+				const char * cell = p_stmt->typed_cell(I + 1, ind, width);
+				if (cell)
+					column::read(std::get<I>(row), cell, ind, width);
+				else
+					column::get(std::get<I>(row), *p_stmt, I + 1);
+				load<I + 1>();
+			}
+
+			// Fetch next row, or become the end iterator
+			void next()
+			{
+				if (p_stmt && p_stmt->fetch_next())
+					load<0>();
+				else
+					p_stmt = NULL;
+			}
+
+		public:
+			//! Construct an iterator on first row (or end iterator if _stmt is NULL)
+			explicit iterator(statement * _stmt)
+				:p_stmt(_stmt)
+			{
+				next();
+			}
+
+			//! Get current row
+			const value_type & operator*() const	{	return row;	}
+
+			//! Get current row
+			const value_type * operator->() const	{	return &row;	}
+
+			//! Advance to next row
+			iterator & operator++()
+			{
+				next();
+				return *this;
+			}
+
+			//! Compare iterators
+			bool operator==(const iterator & r) const	{	return p_stmt == r.p_stmt;	}
+
+			//! Compare iterators
+			bool operator!=(const iterator & r) const	{	return p_stmt != r.p_stmt;	}
+		};
+
+	private:
+		statement * p_stmt;		//!< Statement that rows are fetched from (NULL if empty)
+
+	public:
+		//! Construct a range of the rows of _stmt (empty if _stmt is NULL)
+		explicit typed_rows(statement * _stmt)
+			:p_stmt(_stmt)
+		{}
+
+		//! Fetch the first row
+		iterator begin()	{	return iterator(p_stmt);	}
+
+		//! Get end of rows
+		iterator end()		{	return iterator(NULL);	}
+	};
+
+	//! Mapping of a C++ type to the C and SQL types of a parameter
+	/**
+		It is defined for bool, all integer types, float, double, _tstring,
+		TCHAR strings and std::nullptr_t (a NULL value), and for std::optional
+		of them with C++17. Using any other type with statement::execute(args...)
+		fails to compile.
+	*/
+	template<class T, class Enable = void>
+	struct typed_param;
+
+	template<class T>
+	struct typed_param<T, typename std::enable_if<std::is_integral<T>::value>::type>
+	{
+		static void fill(__param_slot & _slot, const T & _value)
+		{
+			_slot.ptr = NULL;
+			if (std::is_signed<T>::value && (sizeof(T) <= sizeof(SQLINTEGER)))
+			{
+				_slot.value.l = (SQLINTEGER)_value;
+				_slot.c_type = SQL_C_SLONG;
+				_slot.sql_type = SQL_INTEGER;
+				_slot.length = sizeof(SQLINTEGER);
+			}
+			else if (std::is_signed<T>::value)
+			{
+				_slot.value.ll = (SQLBIGINT)_value;
+				_slot.c_type = SQL_C_SBIGINT;
+				_slot.sql_type = SQL_BIGINT;
+				_slot.length = sizeof(SQLBIGINT);
+			}
+			else
+			{	// Unsigned 32 bit values do not fit in INTEGER
+				_slot.value.ull = (SQLUBIGINT)_value;
+				_slot.c_type = SQL_C_UBIGINT;
+				_slot.sql_type = SQL_BIGINT;
+				_slot.length = sizeof(SQLUBIGINT);
+			}
+			_slot.ind = _slot.length;
+			_slot.column_size = 0;
+		}
+	};
+
+	template<>
+	struct typed_param<bool>
+	{
+		static void fill(__param_slot & _slot, const bool & _value)
+		{
+			_slot.ptr = NULL;
+			_slot.value.b = _value?1:0;
+			_slot.c_type = SQL_C_BIT;
+			_slot.sql_type = SQL_BIT;
+			_slot.length = _slot.ind = sizeof(unsigned char);
+			_slot.column_size = 1;
+		}
+	};
+
+	template<>
+	struct typed_param<float>
+	{
+		static void fill(__param_slot & _slot, const float & _value)
+		{
+			_slot.ptr = NULL;
+			_slot.value.f = _value;
+			_slot.c_type = SQL_C_FLOAT;
+			_slot.sql_type = SQL_REAL;
+			_slot.length = _slot.ind = sizeof(float);
+			_slot.column_size = 0;
+		}
+	};
+
+	template<>
+	struct typed_param<double>
+	{
+		static void fill(__param_slot & _slot, const double & _value)
+		{
+			_slot.ptr = NULL;
+			_slot.value.d = _value;
+			_slot.c_type = SQL_C_DOUBLE;
+			_slot.sql_type = SQL_DOUBLE;
+			_slot.length = _slot.ind = sizeof(double);
+			_slot.column_size = 0;
+		}
+	};
+
+	template<>
+	struct typed_param<std::nullptr_t>
+	{
+		static void fill(__param_slot & _slot, const std::nullptr_t &)
+		{
+			_slot.ptr = NULL;
+			_slot.c_type = SQL_C_TCHAR;
+			_slot.sql_type = SQL_VARCHAR;
+			_slot.length = 0;
+			_slot.ind = SQL_NULL_DATA;
+			_slot.column_size = 1;
+		}
+	};
+
+	template<>
+	struct typed_param<const TCHAR *>
+	{
+		static void fill(__param_slot & _slot, const TCHAR * const & _value)
+		{
+			if (!_value)
+			{	// NULL pointer is a NULL value
+				typed_param<std::nullptr_t>::fill(_slot, nullptr);
+				return;
+			}
+			size_t chars = std::char_traits<TCHAR>::length(_value);
+			_slot.ptr = (SQLPOINTER)_value;
+			_slot.c_type = SQL_C_TCHAR;
+			_slot.sql_type = SQL_VARCHAR;
+			_slot.length = _slot.ind = (SQLLEN)(chars * sizeof(TCHAR));
+			_slot.column_size = chars?chars:1;
+		}
+	};
+
+	template<>
+	struct typed_param<TCHAR *>
+		:typed_param<const TCHAR *> {};
+
+	template<size_t N>
+	struct typed_param<TCHAR[N]>
+	{
+		static void fill(__param_slot & _slot, const TCHAR (&_value)[N])
+		{
+			typed_param<const TCHAR *>::fill(_slot, &_value[0]);
+		}
+	};
+
+	template<>
+	struct typed_param<_tstring>
+	{
+		static void fill(__param_slot & _slot, const _tstring & _value)
+		{
+			_slot.ptr = (SQLPOINTER)_value.data();
+			_slot.c_type = SQL_C_TCHAR;
+			_slot.sql_type = SQL_VARCHAR;
+			_slot.length = _slot.ind = (SQLLEN)(_value.size() * sizeof(TCHAR));
+			_slot.column_size = _value.size()?_value.size():1;
+		}
+	};
+
+#ifdef TIODBC_HAS_CXX17
+	template<class T>
+	struct typed_param<std::optional<T> >
+	{
+		static void fill(__param_slot & _slot, const std::optional<T> & _value)
+		{
+			if (_value)
+			{
+				typed_param<T>::fill(_slot, *_value);
+				return;
+			}
+
+			// NULL of the type of T, without a value buffer
+			typed_param<T>::fill(_slot, T());
+			_slot.ptr = NULL;
+			_slot.length = 0;
+			_slot.ind = SQL_NULL_DATA;
+		}
+	};
+#endif // TIODBC_HAS_CXX17
+
+	// Execute a prepared statement with the given parameters
+	template<class... Ts>
+	bool statement::execute(const Ts &... _args)
+	{
+		__param_slot slots[sizeof...(Ts)];
+		int i = 0;
+		int expand[] = { (typed_param<Ts>::fill(slots[i++], _args), 0)... };
+		(void)expand;
+		return execute_params(slots, (int)sizeof...(Ts));
+	}
+
+	// Prepare a query and execute it with the given parameters
+	template<class... Ts>
+	bool statement::prepare_and_execute(connection & _conn, const _tstring & _stmt, const Ts &... _args)
+	{
+		return prepare(_conn, _stmt) && execute(_args...);
+	}
+
+	// Iterate the rows of the result set as typed tuples
+	template<class... Ts>
+	typed_rows<Ts...> statement::rows()
+	{
+		const SQLSMALLINT c_types[] = { typed_column<Ts>::c_type... };
+		if (p_prefetch || (count_columns() < (int)sizeof...(Ts)))
+			return typed_rows<Ts...>(NULL);
+
+		// Without buffers they are read with SQLGetData
+		bind_typed(c_types, (int)sizeof...(Ts));
+		return typed_rows<Ts...>(this);
+	}
+#endif // TIODBC_HAS_CXX11
+
+#ifdef TIODBC_HAS_CXX11
+	//! A thread-safe pool of connections to a Data Source
+	/**
+		Connection pool keeps connections to a Data Source open, so that
+		threads can borrow one without paying for a new connection handshake.
+		It opens <i>min_size</i> connections at construction and grows on demand
+		up to <i>max_size</i>, when all connections are borrowed checkout() waits
+		for one to be returned.
+
+		Connections are borrowed with checkout() which returns a
+		connection_pool::handle, the connection is given back to the pool when
+		the handle is destroyed. A transaction left open by the borrower is rolled
+		back and autocommit mode is restored, or the connection is closed if that fails.
+		@code
+		tiodbc::connection_pool pool("MyDSN", "", "", 2, 16);
+		tiodbc::connection_pool::handle conn = pool.checkout(500);
+		if (conn.valid())
+			my_statement.execute_direct(*conn, "SELECT * FROM books");
+		@endcode
+	@note tiodbc::connection_pool is <B>Uncopiable</b>, <b>NON inheritable</b> and
+		<b>thread-safe</b>. It is available only when compiled with C++11.
+	*/
+	class connection_pool
+	{
+	public:
+		//! Validation hook, returns <b>False</b> if the connection must be discarded.
+		typedef std::function<bool (connection &)> validator_type;
+
+		//! Snapshot of the pool counters
+		struct statistics
+		{
+			unsigned long checkouts;			//!< Successful checkouts
+			unsigned long waits;				//!< Checkouts that waited for a connection to be returned
+			unsigned long timeouts;				//!< Checkouts that timed out
+			unsigned long connects;				//!< Connections opened
+			unsigned long connect_failures;		//!< Connections that failed to open
+			unsigned long validation_failures;	//!< Borrowed connections discarded by the validator
+			unsigned long evictions;			//!< Idle connections closed
+			unsigned long long wait_us;			//!< Total time spent waiting (microseconds)
+			size_t idle;						//!< Connections waiting in the pool
+			size_t total;						//!< All connections of the pool (idle and borrowed)
+		};
+
+		//! A connection borrowed from the pool
+		/**
+			It returns the connection to the pool when it is destroyed.
+		@note connection_pool::handle is <B>Uncopiable</b> but <b>Movable</b>
+		*/
+		class handle
+		{
+		public:
+			friend class connection_pool;
+
+		private:
+			connection_pool * p_pool;	//!< The pool that connection belongs to
+			connection * p_conn;		//!< The borrowed connection
+
+			handle(connection_pool * _pool, connection * _conn);
+
+			// Uncopiable
+			handle(const handle &);
+			handle & operator=(const handle &);
+
+		public:
+			//! Construct an invalid handle
+			handle();
+
+			//! Move constructor
+			handle(handle && r);
+
+			//! Move operator
+			handle & operator=(handle && r);
+
+			//! Destructor, returns connection to the pool
+			~handle();
+
+			//! Check if it holds a connection
+			bool valid() const
+			{
+				return p_conn != NULL;
+			}
+
+			//! Access the connection
+			connection & operator*() const
+			{
+				return *p_conn;
+			}
+
+			//! Access the connection
+			connection * operator->() const
+			{
+				return p_conn;
+			}
+
+			//! Return connection to the pool before destruction
+			void release();
+		};
+
+	private:
+		// Idle connection
+		struct idle_connection
+		{
+			connection * p_conn;
+			std::chrono::steady_clock::time_point since;
+		};
+
+		_tstring m_dsn;				//!< Data Source of connections
+		_tstring m_user;			//!< User of connections
+		_tstring m_pass;			//!< Password of connections
+		size_t min_size;			//!< Connections kept open even if idle
+		size_t max_size;			//!< Maximum connections
+		size_t total_size;			//!< Opened connections (idle, borrowed or being opened)
+		std::chrono::milliseconds idle_timeout;	//!< Idle time after which connections are closed
+		validator_type m_validator;
+		_tstring m_last_error;
+		std::vector<idle_connection> m_idle;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_returned;
+
+		// Counters
+		std::atomic<unsigned long> n_checkouts, n_waits, n_timeouts, n_connects,
+			n_connect_failures, n_validation_failures, n_evictions;
+		std::atomic<unsigned long long> n_wait_us;
+
+		// Return a connection to the pool
+		void checkin(connection * _conn);
+
+		// Remove expired idle connections (m_mutex must be locked)
+		void collect_expired(std::vector<connection *> & _expired);
+
+		// Close connections and update the pool size
+		void destroy(std::vector<connection *> & _conns);
+
+		// Uncopiable
+		connection_pool(const connection_pool &);
+		connection_pool & operator=(const connection_pool &);
+
+	public:
+		//! Construct a pool and open its minimum connections
+		/**
+		@param _dsn The name of the Data Source
+		@param _user The username for authenticating to the Data Source.
+		@param _pass The password for authenticating to the Data Source.
+		@param _min_size Connections that are opened at construction and are
+			never closed for being idle.
+		@param _max_size Maximum number of connections, borrowed or idle.
+		*/
+		connection_pool(const _tstring & _dsn,
+			const _tstring & _user,
+			const _tstring & _pass,
+			size_t _min_size,
+			size_t _max_size);
+
+		//! Destructor
+		/**
+			It closes all idle connections. All handles must have been
+			destroyed before the pool.
+		*/
+		~connection_pool();
+
+		//! Borrow a connection
+		/**
+			It returns the most recently used idle connection that passes validation,
+			or opens a new one if the pool has not reached its maximum size.
+			Otherwise it waits until a connection is returned.
+		@param _timeout_ms Maximum time to wait in milliseconds.
+		@return A valid handle on success or an invalid handle if the wait timed out
+			or a new connection could not be opened (see last_error()).
+		*/
+		handle checkout(unsigned long _timeout_ms);
+
+		//! Set the validation hook of borrowed connections
+		/**
+			The validator is called outside of the pool lock for every idle
+			connection before it is handed out. Connections failing validation
+			are closed and another one is tried. By default only connection::connected()
+			is checked.
+		*/
+		void set_validator(const validator_type & _validator);
+
+		//! Set the time after which idle connections above minimum size are closed
+		/**
+		@param _idle_ms Idle time in milliseconds, 0 disables eviction (default).
+		*/
+		void set_idle_timeout(unsigned long _idle_ms);
+
+		//! Close idle connections that have expired
+		/**
+			Expired connections are also closed on every checkout and return,
+			this can be called periodically on an otherwise quiet pool.
+		@return The number of connections closed.
+		*/
+		size_t evict_idle();
+
+		//! Get a snapshot of the pool counters
+		statistics stats() const;
+
+		//! Get the error of the last connection that failed to open
+		_tstring last_error() const;
+	};	// !connection_pool
+
+	//! A histogram of latencies with logarithmic buckets
+	/**
+		Every power of two is split in 8 buckets, so values are kept with a relative
+		error of at most 6.25% from 1 nanosecond up to the full 64-bit range.
+		Recording is lock-free and can be done by many threads at once,
+		reading while recording gives an approximate but consistent enough snapshot.
+	@note tiodbc::latency_histogram is <B>Uncopiable</b>
+	*/
+	class latency_histogram
+	{
+	public:
+		//! Buckets of the histogram
+		enum
+		{
+			sub_buckets = 8,		//!< Buckets per power of two
+			bucket_count = 496		//!< Total buckets
+		};
+
+	private:
+		std::atomic<unsigned long long> m_buckets[bucket_count];
+		std::atomic<unsigned long long> n_count, n_sum_ns, n_max_ns;
+
+		// Uncopiable
+		latency_histogram(const latency_histogram &);
+		latency_histogram & operator=(const latency_histogram &);
+
+	public:
+		//! Construct an empty histogram
+		latency_histogram();
+
+		//! Add a latency in nanoseconds
+		void record(unsigned long long _ns);
+
+		//! Get the number of recorded latencies
+		unsigned long long count() const;
+
+		//! Get the mean latency in nanoseconds
+		unsigned long long mean_ns() const;
+
+		//! Get the maximum latency in nanoseconds
+		unsigned long long max_ns() const;
+
+		//! Get a percentile of latencies in nanoseconds
+		/**
+		@param _fraction The percentile as fraction, e.g. 0.5 for p50, 0.99 for p99
+			and 0.999 for p999.
+		@return The middle of the bucket that the percentile falls in, 0 if empty.
+		*/
+		unsigned long long percentile_ns(double _fraction) const;
+
+		//! Set everything to zero
+		void reset();
+
+		//! Get the bucket of a latency
+		static int bucket_of(unsigned long long _ns);
+
+		//! Get the smallest latency of a bucket
+		static unsigned long long bucket_lower(int _bucket);
+
+		//! Get the width of a bucket
+		static unsigned long long bucket_width(int _bucket);
+	};	// !latency_histogram
+
+	//! Latency profile of one normalized query
+	/**
+		Profiles are owned by a query_registry and live as long as it.
+	@see query_registry
+	*/
+	class query_profile
+	{
+	public:
+		friend class query_registry;
+		friend class statement;
+
+	private:
+		const query_registry * p_registry;	//!< Registry that profile belongs to
+		unsigned long long m_id;	//!< Hash of fingerprint
+		_tstring m_fingerprint;		//!< Normalized query text
+		std::atomic<unsigned long> n_prepares;	//!< Times query was prepared
+		std::atomic<unsigned long> n_failures;	//!< Executions that failed
+		latency_histogram m_execute;	//!< Latency of execution
+		latency_histogram m_fetch;		//!< Latency from end of execution until the last row
+
+		query_profile(const query_registry * _registry, unsigned long long _id, const _tstring & _fingerprint);
+
+		// Uncopiable
+		query_profile(const query_profile &);
+		query_profile & operator=(const query_profile &);
+
+	public:
+		//! Get the hash of the fingerprint
+		unsigned long long id() const	{	return m_id;	}
+
+		//! Get the normalized query text
+		const _tstring & fingerprint() const	{	return m_fingerprint;	}
+
+		//! Get the number of times that query was prepared
+		unsigned long prepares() const	{	return n_prepares;	}
+
+		//! Get the number of executions that failed
+		unsigned long failures() const	{	return n_failures;	}
+
+		//! Latency of executions, as long as execute() or execute_direct() run
+		const latency_histogram & execute_latency() const	{	return m_execute;	}
+
+		//! Latency from the end of execution until the result set is fetched completely
+		const latency_histogram & fetch_latency() const	{	return m_fetch;	}
+
+		//! Set everything to zero
+		void reset();
+	};	// !query_profile
+
+	//! Registry of latency profiles of queries
+	/**
+		Queries are normalized into a fingerprint, by replacing literals with '?'
+		and removing comments and whitespace, so that executions of the same
+		query with different values share the same profile. Every profile keeps
+		a histogram of execution latency and one of fetch-to-completion latency.
+
+		Statements report to the registry that their connection is attached to
+		with connection::set_query_registry(). Lookup and recording are lock-free,
+		profiles are never removed and the registry holds up to a fixed
+		number of them, queries that do not fit are counted as dropped.
+		Asynchronous executions are recorded when they are polled to completion,
+		so their latency includes the polling interval of the application.
+
+		The registry can be dumped as JSON to a file, once with dump() or
+		periodically from a background thread with start_dump().
+	@note tiodbc::query_registry is <B>Uncopiable</b>
+	*/
+	class query_registry
+	{
+	private:
+		std::unique_ptr<std::atomic<query_profile *>[]> m_slots;	//!< Open addressing hash table
+		size_t m_mask;					//!< Slots - 1
+		std::atomic<unsigned long> n_dropped;	//!< Lookups that did not fit in table
+
+		// Periodic dump
+		std::thread m_dumper;
+		std::mutex m_dump_mutex;
+		std::condition_variable m_dump_wakeup;
+		bool b_dumping;
+		std::string m_dump_path;
+		std::chrono::milliseconds dump_interval;
+
+		// Body of the dumping thread
+		void dump_loop();
+
+		// Uncopiable
+		query_registry(const query_registry &);
+		query_registry & operator=(const query_registry &);
+
+	public:
+		//! Construct a registry
+		/**
+		@param _capacity Maximum number of profiles, rounded up to a power of two.
+		*/
+		explicit query_registry(size_t _capacity = 1024);
+
+		//! Destructor, stops periodic dump
+		~query_registry();
+
+		//! Normalize the text of a query into its fingerprint
+		/**
+			String and numeric literals are replaced with '?', comments are removed
+			and whitespace is kept only where it separates two words. Quoted
+			identifiers are kept as they are.
+		*/
+		static _tstring normalize(const _tstring & _sql);
+
+		//! Get the profile of a query, adding it if needed
+		/**
+		@param _sql The query text, it is normalized first.
+		@return The profile or NULL if the registry is full.
+		*/
+		query_profile * profile(const _tstring & _sql);
+
+		//! Find the profile of a query
+		/**
+		@return The profile or NULL if the query has not been reported.
+		*/
+		const query_profile * find(const _tstring & _sql) const;
+
+		//! Get all profiles
+		std::vector<const query_profile *> profiles() const;
+
+		//! Get the number of queries that were not profiled because the registry was full
+		unsigned long dropped() const;
+
+		//! Set the histograms of all profiles to zero
+		void reset();
+
+		//! Write all profiles as JSON to a file
+		/**
+			The file is written next to its final path and renamed over it,
+			readers never see a half written file.
+		@return <b>True</b> if the file was written.
+		*/
+		bool dump(const std::string & _path) const;
+
+		//! Dump to a file periodically from a background thread
+		/**
+			A previous periodic dump is stopped first.
+		@param _path The file that is replaced on every dump.
+		@param _interval_ms Time between dumps in milliseconds.
+		@return <b>True</b> if the thread was started.
+		*/
+		bool start_dump(const std::string & _path, unsigned long _interval_ms);
+
+		//! Stop the periodic dump, dumping one last time
+		void stop_dump();
+	};	// !query_registry
+
+	//! Reads a query in partitions over parallel connections
+	/**
+		The query is a template that is expanded once for each partition by
+		replacing the following placeholders:
+		- <b>{partition}</b> The index of the partition, from 0 to partitions - 1.
+		- <b>{partitions}</b> The number of partitions.
+		- <b>{lower}</b> and <b>{upper}</b> The inclusive lower and the exclusive
+		upper bound of the key range of the partition, see set_key_range().
+		.
+		Every partition is read by its own thread on its own connection. Rows are
+		consumed on the partition threads with for_each_row() or for_each_rowset(),
+		or as a merged stream of rowsets on the calling thread with start() and next().
+		@code
+		tiodbc::parallel_reader reader("MyDSN", "", "",
+			"SELECT id, title FROM books WHERE MOD(id, {partitions}) = {partition}", 8);
+		reader.start(16);
+		tiodbc::columnar_result rows;
+		while(reader.next(rows))
+			process(rows);
+		if (!reader.last_error().empty())
+			cout << reader.last_error() << endl;
+		@endcode
+	@note tiodbc::parallel_reader is <B>Uncopiable</b> and <b>NON inheritable</b>.
+		It is available only when compiled with C++11.
+	*/
+	class parallel_reader
+	{
+	public:
+		//! Consumer of rows, returns <b>False</b> to stop reading.
+		/**
+			It is called on the thread of the partition with the statement
+			positioned on the row.
+		*/
+		typedef std::function<bool (int _partition, statement & _stmt)> row_callback;
+
+		//! Consumer of rowsets, returns <b>False</b> to stop reading.
+		/**
+			It is called on the thread of the partition, the rowset may be
+			moved away.
+		*/
+		typedef std::function<bool (int _partition, columnar_result & _rows)> rowset_callback;
+
+	private:
+		// Rowset waiting in the merged stream
+		struct queued_rowset
+		{
+			int partition;
+			columnar_result rows;
+		};
+
+		_tstring m_dsn;				//!< Data Source of connections
+		_tstring m_user;			//!< User of connections
+		_tstring m_pass;			//!< Password of connections
+		_tstring m_query;			//!< Query template
+		int n_partitions;			//!< Number of partitions
+		bool b_key_range;			//!< A flag if key range was set
+		long long key_first;		//!< First key of the range
+		long long key_last;			//!< Last key of the range
+		unsigned long rowset_rows;	//!< Rows fetched at once
+		_tstring m_last_error;		//!< First error of any partition
+		mutable std::mutex m_mutex;
+		std::condition_variable m_produced;		//!< A rowset was queued or a partition ended
+		std::condition_variable m_consumed;		//!< A rowset was taken from the queue
+		std::list<queued_rowset> m_queue;		//!< Merged stream
+		size_t queue_size;			//!< Rowsets in m_queue
+		size_t queue_limit;			//!< Maximum rowsets in m_queue
+		int n_running;				//!< Partitions still being read
+		std::atomic<bool> b_stop;	//!< A flag to stop all partitions
+		std::vector<std::thread> m_threads;
+
+		// Read one partition
+		void read_partition(int _partition, const row_callback * _row_func, const rowset_callback * _rowset_func);
+
+		// Start the threads of all partitions
+		bool launch(const row_callback * _row_func, const rowset_callback * _rowset_func);
+
+		// Wait all partition threads
+		void join();
+
+		// Record the error of a partition and stop the others
+		void fail(int _partition, const _tstring & _error);
+
+		// Put a rowset in the merged stream, waiting for space
+		bool enqueue(int _partition, columnar_result & _rows);
+
+		// Uncopiable
+		parallel_reader(const parallel_reader &);
+		parallel_reader & operator=(const parallel_reader &);
+
+	public:
+		//! Construct a reader
+		/**
+		@param _dsn The name of the Data Source
+		@param _user The username for authenticating to the Data Source.
+		@param _pass The password for authenticating to the Data Source.
+		@param _query The query template, see parallel_reader for its placeholders.
+		@param _partitions Number of partitions, threads and connections.
+		*/
+		parallel_reader(const _tstring & _dsn,
+			const _tstring & _user,
+			const _tstring & _pass,
+			const _tstring & _query,
+			int _partitions);
+
+		//! Destructor, stops reading
+		~parallel_reader();
+
+		//! Split a range of keys in equal partitions
+		/**
+			Partition <i>i</i> gets the keys <b>{lower}</b> <= key < <b>{upper}</b>,
+			the last partition ends at _last + 1.
+			@code
+			"SELECT * FROM books WHERE id >= {lower} AND id < {upper}"
+			@endcode
+		@param _first The first key of the range.
+		@param _last The last key of the range.
+		@return <b>True</b> if the range was accepted or <b>False</b> if <i>_last</i>
+			is less than <i>_first</i> or _last + 1 does not fit in 64 bits.
+		@remarks Reading fails if the query has range placeholders and no range was set.
+		*/
+		bool set_key_range(long long _first, long long _last);
+
+		//! Set the number of rows that are fetched at once
+		/**
+			It is the rowset size of the statements of for_each_row() and the size of
+			rowsets of for_each_rowset() and next(). Default is 1024.
+		*/
+		bool set_rowset_size(unsigned long _rows);
+
+		//! Get the number of partitions
+		int partitions() const;
+
+		//! Get the query of a partition
+		_tstring partition_query(int _partition) const;
+
+		//! Read all partitions passing every row to a callback
+		/**
+			It returns when all partitions have been read. The callback is
+			called concurrently from all partition threads.
+		@return <b>True</b> if all partitions were read completely or <b>False</b>
+			if the callback stopped reading or there was an error. In case of error
+			check last_error() for detailed description of problem.
+		*/
+		bool for_each_row(const row_callback & _func);
+
+		//! Read all partitions passing every rowset to a callback
+		/**
+		@see for_each_row()
+		*/
+		bool for_each_rowset(const rowset_callback & _func);
+
+		//! Start reading all partitions into a merged stream
+		/**
+			Partition threads queue their rowsets and wait when the queue is full.
+		@param _queue_rowsets Maximum rowsets waiting in the queue.
+		@return <b>True</b> if the threads were started.
+		@see next(), stop()
+		*/
+		bool start(size_t _queue_rowsets);
+
+		//! Get the next rowset of the merged stream
+		/**
+			Rowsets of different partitions are interleaved in the order they were fetched.
+		@param _rows The object that will receive the rowset.
+		@param _partition If not NULL it receives the partition of the rowset.
+		@return <b>True</b> if a rowset was taken or <b>False</b> if all partitions have
+			ended. When it returns <b>False</b> check last_error() to distinguish
+			the end of results from an error.
+		*/
+		bool next(columnar_result & _rows, int * _partition = NULL);
+
+		//! Stop reading and wait all partition threads
+		void stop();
+
+		//! Get the first error of any partition
+		_tstring last_error() const;
+	};	// !parallel_reader
+#endif // TIODBC_HAS_CXX11
 };
 
 #endif // !_TIODBC_HPP_DEFINED_